@@ -0,0 +1,17 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: geometry.h
+// Description: Measured dimensions of the drive, shared by the drive subsystem
+// and the host-side tools that replay and simulate it.
+
+#pragma once
+
+namespace geometry {
+  const double WHEEL_CIRCUMFERENCE_MM = 319.19;
+  const double TRACK_WIDTH_MM = 320.0;
+  const double WHEEL_BASE_MM = 120.0;
+  const double EXTERNAL_GEAR_RATIO = 1.0;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: allocator.h
+// Description: Decides how much of a shared current budget each motor gets
+// from its latest readings. Kept apart from the motors themselves so a
+// recorded run can be fed back through it.
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+namespace lib {
+  struct MotorSample {
+    double temperatureC;
+    double currentAmps;
+    double velocityRPM;
+  };
+
+  class CurrentAllocator {
+  public:
+    CurrentAllocator(double totalCurrentAmps);
+
+    // Higher priority motors get a bigger share of the budget while they are
+    // moving, a motor that isn't moving only gets enough to hold its load.
+    // holdCurrentAmps is the least it is ever held at. Returns the motor's
+    // index.
+    int addMotor(double priority, double holdCurrentAmps);
+
+    // One sample per motor, in the order they were added
+    void allocate(const std::vector<MotorSample>& samples, int32_t nowMS);
+
+    double getLimitAmps(int index);
+    // What the motor is held at once it stops, at least its holdCurrentAmps
+    double getHoldAmps(int index);
+    // 1 at ambient, 0 once the firmware would start derating
+    double getHeadroom(int index);
+    // Fraction of full speed the motor should be asked for, drops as the
+    // motor gets close to the firmware's derating temperature
+    double getSpeedScale(int index);
+
+  private:
+    struct Motor {
+      double priority;
+      double holdCurrentAmps;
+      // Measured draw while holding still, with some margin
+      double holdLimitAmps;
+
+      double headroom;
+      double limitAmps;
+      double speedScale;
+      // When the motor started drawing its whole limit, -1 if it isn't
+      int32_t saturatedSinceMS;
+      // When the motor last dropped below MOVING_RPM, -1 while it is moving
+      int32_t restingSinceMS;
+    };
+
+    // Most a single V5 motor will ever draw
+    const double MAX_MOTOR_CURRENT_AMPS = 2.5;
+    // Firmware halves the current limit from here on
+    const double DERATE_TEMPERATURE_C = 55.0;
+    const double AMBIENT_TEMPERATURE_C = 25.0;
+    // Below this a motor is considered to be holding rather than moving
+    const double MOVING_RPM = 5.0;
+    // Drawing this much of its limit means the motor wants more
+    const double SATURATED_FRACTION = 0.9;
+    // How long a saturated motor gets to start moving before it is treated
+    // as stalled
+    const int32_t START_WINDOW_MS = 300;
+    // How long a motor keeps its share after it stops, so it has settled
+    // under its load before its holding draw is measured
+    const int32_t SETTLE_WINDOW_MS = 200;
+    // Held at this much more than its measured holding draw, so it doesn't
+    // sit right at its limit and look saturated
+    const double HOLD_MARGIN = 1.25;
+    // Speed starts getting capped once headroom falls under the knee
+    const double SPEED_SCALE_KNEE = 0.3;
+    const double MIN_SPEED_SCALE = 0.5;
+
+    const double TOTAL_CURRENT_AMPS;
+
+    std::vector<Motor> motors;
+  };
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: budget.h
+// Description: Shares a current budget between motors based on what they are
+// doing and how much thermal headroom they have left, so the firmware never
+// has to derate them on its own.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "lib/allocator.h"
+#include "vex.h"
+
+namespace lib {
+  class MotorBudget {
+  public:
+    const std::string NAME;
+
+    MotorBudget(const std::string& name, double totalCurrentAmps);
+
+    // See CurrentAllocator::addMotor(). Returns the index to ask for the
+    // motor's speed scale and limit with.
+    int addMotor(const std::string& name, vex::motor& motor, 
+      double priority, double holdCurrentAmps);
+
+    // Samples every motor, reallocates the budget and applies the limits
+    void periodic();
+    void printTelemetry();
+
+    double getSpeedScale(int index);
+    double getLimitAmps(int index);
+
+  private:
+    struct Entry {
+      vex::motor* motor;
+      double powerWatts;
+
+      std::string labelTemperature;
+      std::string labelCurrent;
+      std::string labelPower;
+      std::string labelHeadroom;
+      std::string labelLimit;
+      std::string labelHold;
+    };
+
+    CurrentAllocator allocator;
+    std::vector<Entry> entries;
+    std::vector<MotorSample> samples;
+
+    std::string labelAllocated = NAME + "/ALLOCATED_A";
+  };
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: config.h
+// Description: Saves and loads a fixed-size block of settings on the SD card.
+// The file layout is in configblock.h.
+
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+#include "vex.h"
+
+namespace lib {
+  class ConfigFile {
+  public:
+    // Bump version whenever the layout of the saved block changes
+    ConfigFile(const std::string& fileName, uint32_t version);
+
+    bool save(const void* data, uint32_t size);
+    // Leaves data untouched and returns false if the file is missing, was
+    // saved by a different version or size, or fails its checksum
+    bool load(void* data, uint32_t size);
+
+  private:
+    const std::string FILE_NAME;
+    const uint32_t VERSION;
+  };
+}
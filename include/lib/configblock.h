@@ -0,0 +1,28 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: configblock.h
+// Description: Layout of a saved block of settings, with enough of a header to
+// reject files that are stale or corrupted. Free of device calls so the
+// host-side tools can read and write the same files the robot does.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace lib {
+  // Header followed by the block, ready to write out as is
+  std::vector<uint8_t> packConfig(uint32_t version, const void* data, 
+    uint32_t size);
+
+  // Leaves data untouched and returns false if contents were saved by a
+  // different version or size, or fail their checksum
+  bool unpackConfig(const std::vector<uint8_t>& contents, uint32_t version, 
+    void* data, uint32_t size);
+
+  // Bytes a packed block of size takes up
+  uint32_t packedConfigSize(uint32_t size);
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: feedforward.h
+// Description: Voltage feedforward for a DC motor mechanism,
+// V = kS * sign(v) + kV * v + kA * a, and a least-squares fit for its gains.
+
+#pragma once
+
+#include <vector>
+
+namespace lib {
+  struct FeedforwardSample {
+    double volts;
+    double velocity;
+    double acceleration;
+  };
+
+  class Feedforward {
+  public:
+    double kS;
+    double kV;
+    double kA;
+
+    Feedforward(double kS, double kV, double kA);
+
+    double calculate(double velocity, double acceleration);
+
+    // Fits kS and kV from a slow voltage ramp, where acceleration is close to
+    // zero, then kA from whatever voltage is left over during a step test.
+    // Returns false and leaves result alone if there isn't enough data.
+    static bool fit(const std::vector<FeedforwardSample>& quasistatic,
+      const std::vector<FeedforwardSample>& step, Feedforward& result);
+
+  private:
+    // Samples slower than this are still stuck in static friction
+    static constexpr double MIN_VELOCITY = 10.0;
+    // Samples accelerating slower than this don't say anything about kA
+    static constexpr double MIN_ACCELERATION = 100.0;
+    static const int MIN_SAMPLES = 10;
+  };
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: frame.h
+// Description: One control tick worth of device readings along with what the
+// control loop did with them. Free of device calls so the host-side replay
+// tool can read the same log the robot writes.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace lib {
+  // Bits of SensorFrame::limitSwitches
+  const uint8_t LIMIT_UPPER = 0x01;
+  const uint8_t LIMIT_LOWER = 0x02;
+  const uint8_t LIMIT_SURFACE = 0x04;
+
+  // Order of the per-motor arrays in SensorFrame, also the order motors are
+  // added to the motor budget in
+  enum FrameMotor {
+    MOTOR_LEFT_DRIVE,
+    MOTOR_RIGHT_DRIVE,
+    MOTOR_ELEVATOR,
+    MOTOR_INTAKE,
+    FRAME_MOTOR_COUNT
+  };
+
+  // Which control loop a frame was recorded from
+  enum ControlMode {
+    // Teleop, or nothing closed-loop running
+    CONTROL_NONE,
+    // Profiled fixed-distance leg, setpoint is the distance in mm
+    CONTROL_DRIVE,
+    // Profiled turn, setpoint is the angle in degrees, clockwise positive
+    CONTROL_TURN,
+    // Scan sweep, setpoint is the rotation the scan is centered on
+    CONTROL_SCAN,
+    // Creeping up on an object, setpoint is the stopping distance in mm
+    CONTROL_APPROACH
+  };
+
+  // Floats are used on purpose to keep the log small, the sensors are not
+  // more precise than that anyway
+  struct SensorFrame {
+    uint32_t timestampMS;
+
+    float leftPositionDegrees;
+    float rightPositionDegrees;
+    float elevatorPositionDegrees;
+    float intakePositionDegrees;
+    float headingDegrees;
+    // Unwrapped heading, keeps counting past 360
+    float rotationDegrees;
+    float gyroRateDegPerSec;
+    float distanceMM;
+    float opticalRed;
+    float opticalGreen;
+    float opticalBlue;
+    float batteryVolts;
+
+    float motorVelocityRPM[FRAME_MOTOR_COUNT];
+    float motorCurrentAmps[FRAME_MOTOR_COUNT];
+    float motorTemperatureC[FRAME_MOTOR_COUNT];
+    // Limit the motor budget had applied when the frame was read
+    float motorLimitAmps[FRAME_MOTOR_COUNT];
+
+    uint8_t limitSwitches;
+
+    // One of ControlMode
+    uint8_t controlMode;
+    // Counts up every time a control loop starts, so back-to-back runs of the
+    // same loop can be told apart. The first frame of a drive or turn is the
+    // reading it measures from, logged before any output is sent.
+    uint16_t controlRun;
+    float setpoint;
+    // Demand the loop sent to each side of the drive. mm/s for a drive or
+    // turn, deg/s of rotation for a scan and percent of full speed for an
+    // approach.
+    float leftOutput;
+    float rightOutput;
+  };
+
+  // Start of every sensor log
+  struct LogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frameSize;
+  };
+
+  // "SPUD" in ASCII
+  const uint32_t LOG_MAGIC = 0x53505544;
+  const uint16_t LOG_VERSION = 1;
+
+  // Where the control loops get their readings from. The robot reads the
+  // devices and logs each frame it is handed back, with the loop's outputs
+  // filled in. Frames from between control loops are logged as CONTROL_NONE
+  // and may land in the middle of a loop's frames.
+  class SensorSource {
+  public:
+    virtual ~SensorSource() {}
+
+    virtual SensorFrame read() = 0;
+    virtual void record(const SensorFrame& frame) = 0;
+
+    // Call as a control loop starts, returns the number to tag its frames with
+    uint16_t startControlRun() {
+      controlRuns++;
+      return controlRuns;
+    }
+
+  private:
+    uint16_t controlRuns = 0;
+  };
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: logger.h
+// Description: Records every device reading to the SD card, along with what
+// each control loop did with it, so that a run from the field can be replayed
+// on a computer.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "lib/frame.h"
+#include "vex.h"
+
+namespace lib {
+  class Logger {
+  public:
+    Logger(const std::string& fileName);
+
+    // Truncates the log file and writes a fresh header
+    bool startRecording();
+    // Buffers a frame, the buffer is written to the SD card once it is full.
+    // Does nothing until recording has started. Safe to call from any thread.
+    void record(const SensorFrame& frame);
+    // Writes whatever is left in the buffer to the SD card
+    void flush();
+
+  private:
+    // 64 frames at 10 ms per tick is a write at most every 0.6 seconds
+    static const size_t BUFFER_FRAMES = 64;
+
+    const std::string FILE_NAME;
+
+    // The recorder thread and the control loops both record
+    vex::mutex bufferLock;
+    std::vector<SensorFrame> buffer;
+
+    bool recording;
+
+    // Call with bufferLock held
+    void writeBuffer();
+  };
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: motion.h
+// Description: Profiled drive and turn controllers. They only see numbers in
+// and out, so the drive subsystem, the replay tool and the simulator all run
+// the exact same logic.
+
+#pragma once
+
+#include "lib/profile.h"
+#include "lib/pid.h"
+
+namespace lib {
+  struct DriveGains {
+    double maxVelocityMMPerSec;
+    double maxAccelerationMMPerSec2;
+    // mm/s of correction per mm a side falls behind the profile
+    double positionKP;
+    double toleranceMM;
+    // How long past the end of the profile to wait for the wheels to settle
+    double settleTimeoutMS;
+  };
+
+  struct TurnGains {
+    double maxVelocityDegPerSec;
+    double maxAccelerationDegPerSec2;
+    // deg/s of correction per degree of heading error
+    double kP;
+    double kI;
+    double kD;
+    double toleranceDegrees;
+    double rateToleranceDegPerSec;
+    double settleTimeoutMS;
+  };
+
+  // Gains from tuning.h
+  DriveGains defaultDriveGains();
+  TurnGains defaultTurnGains();
+
+  struct DriveCommand {
+    double leftVelocityMMPerSec;
+    double rightVelocityMMPerSec;
+    double accelerationMMPerSec2;
+    // Stop once this is set, the velocities are meaningless then
+    bool done;
+  };
+
+  struct TurnCommand {
+    double velocityDegPerSec;
+    double accelerationDegPerSec2;
+    bool done;
+  };
+
+  class ProfiledDrive {
+  public:
+    // Distance may be negative to drive backward
+    ProfiledDrive(double distanceMM, const DriveGains& gains);
+
+    // Travel is measured from where the move started. Done once the profile
+    // has finished and both sides are within tolerance, or the settle time
+    // has run out.
+    DriveCommand calculate(double elapsedSeconds, 
+      double leftTravelMM, double rightTravelMM);
+
+  private:
+    TrapezoidProfile profile;
+    DriveGains gains;
+  };
+
+  class ProfiledTurn {
+  public:
+    // Clockwise positive, matching the inertial sensor
+    ProfiledTurn(double angleDegrees, const TurnGains& gains);
+
+    // Done once the profile has finished and the robot is on heading and no
+    // longer rotating, or the settle time has run out
+    TurnCommand calculate(double elapsedSeconds, 
+      double turnedDegrees, double rateDegPerSec);
+
+  private:
+    TrapezoidProfile profile;
+    TurnGains gains;
+    PID controller;
+    double lastSeconds;
+  };
+
+  // Creep speed toward an object in front of the distance sensor, 0 once it
+  // is within stopDistanceMM
+  double approachDemandPct(double distanceMM, double stopDistanceMM, 
+    double speedPct);
+}
@@ -0,0 +1,29 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: pid.h
+// Description: Plain PID controller on an error signal.
+
+#pragma once
+
+namespace lib {
+  class PID {
+  public:
+    PID(double kP, double kI, double kD);
+
+    double calculate(double error, double dtSeconds);
+    // Clears the integral and derivative history, call before a new move
+    void reset();
+
+  private:
+    double kP;
+    double kI;
+    double kD;
+
+    double integral;
+    double lastError;
+    bool hasLastError;
+  };
+}
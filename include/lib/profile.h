@@ -0,0 +1,35 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: profile.h
+// Description: Trapezoidal motion profile from rest to rest.
+
+#pragma once
+
+namespace lib {
+  struct ProfileState {
+    double position;
+    double velocity;
+    double acceleration;
+  };
+
+  class TrapezoidProfile {
+  public:
+    // Distance may be negative, the profile is mirrored in that case. Falls
+    // back to a triangle when the move is too short to reach maxVelocity.
+    TrapezoidProfile(double distance, double maxVelocity, double maxAcceleration);
+
+    ProfileState sample(double timeSeconds);
+    double totalTimeSeconds();
+
+  private:
+    double distance;
+    double direction;
+    double acceleration;
+    double peakVelocity;
+    double accelerationTime;
+    double cruiseTime;
+  };
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: routines.h
+// Description: The autonomous routines, written against an interface rather
+// than the devices so the robot and the simulator run the exact same steps.
+
+#pragma once
+
+#include "lib/frame.h"
+#include "lib/scan.h"
+#include <deque>
+
+namespace lib {
+  // Everything calibration can change about the routines. Saved to the SD card
+  // as is, so bump ROUTINE_SETTINGS_VERSION whenever the layout changes.
+  struct RoutineSettings {
+    // Distance sensor readings that end each approach
+    float pickupDistanceMM;
+    float prepPlaceDistanceMM;
+    float placeDistanceMM;
+    float pickupHeightMM;
+    float clearTopBoxHeightMM;
+    float placeCupHeightMM;
+    float stowElevatorMM;
+    float clawOpenRotations;
+    float clawClosedRotations;
+  };
+
+  const uint32_t ROUTINE_SETTINGS_VERSION = 1;
+
+  // Compiled-in settings, the approach distances come from tuning.h
+  RoutineSettings defaultRoutineSettings();
+  // Catches values that passed the checksum but make no sense on this field
+  bool isValidRoutineSettings(const RoutineSettings& settings);
+
+  struct RoutineGains {
+    // Percent of full speed while creeping toward a cup or box
+    double approachSpeedPct;
+    // Give up on an approach if nothing shows up by then
+    double approachTimeoutMS;
+    double scanRateDegPerSec;
+    // Stop the quick approach after a scan this far short
+    double scanApproachMarginMM;
+  };
+
+  // Gains from tuning.h
+  RoutineGains defaultRoutineGains();
+
+  // Where to go looking for a cup. Headings are absolute from the inertial
+  // sensor, which reads 0 facing forward from the start position.
+  struct CupTarget {
+    double headingDegrees;
+    // How far to drive along the heading before scanning
+    double leadInMM;
+  };
+
+  // Where to put a cup once it has been picked up
+  struct BoxSlot {
+    double headingDegrees;
+    double placeHeightMM;
+  };
+
+  // Two slots with the same heading and height would stack cups on each other
+  bool hasDistinctSlots(const std::deque<BoxSlot>& slots);
+
+  // Which routine a timed run belongs to
+  enum RoutineRun {
+    RUN_PICKUP,
+    RUN_PLACE,
+    // One full cycle of the cup pipeline, from leaving the last box to
+    // backing out of the next one
+    RUN_CUP
+  };
+
+  // What the routines drive. The robot forwards each call to its subsystems,
+  // the simulator to its world. Distances are in mm and angles in degrees,
+  // clockwise positive.
+  class RoutineRobot {
+  public:
+    virtual ~RoutineRobot() {}
+
+    // Negative drives backward. Without blocking it returns straight away and
+    // the drive finishes on its own.
+    virtual void driveDistance(double distanceMM, bool blocking) = 0;
+    // Both block until the turn is done
+    virtual void turnToAngle(double angleDegrees) = 0;
+    virtual void turnToHeading(double headingDegrees) = 0;
+    virtual void spinInPlace(double degreesPerSec) = 0;
+    virtual void drivePct(double speedPct) = 0;
+    virtual void stopDrive() = 0;
+
+    virtual void setElevatorMM(double heightMM, bool blocking) = 0;
+    virtual void setClawRotations(double rotations, bool blocking) = 0;
+
+    virtual void wait(double ms) = 0;
+    virtual double timeMS() = 0;
+
+    // Called as each pickup, place and cup cycle finishes
+    virtual void recordRun(RoutineRun run, double durationMS, bool success) = 0;
+  };
+
+  class Routines {
+  public:
+    // Settings are read each time a routine runs, so loading or calibrating
+    // them later is picked up
+    Routines(SensorSource& sensors, RoutineRobot& robot,
+      const RoutineSettings& settings, const RoutineGains& gains);
+
+    // Without blocking the claw and elevator move together and the caller is
+    // free to drive in the meantime
+    void prepPickup(bool blocking);
+    // Creeps forward until the distance sensor reads within stopDistanceMM.
+    // Returns false if nothing showed up before the approach timed out.
+    bool approach(double stopDistanceMM);
+    // Sweeps across the arc in front of the robot and leaves it facing the
+    // nearest cup-sized return. Returns false if nothing looked like a cup.
+    bool scanForCup(ScanTarget& target);
+    // Returns false if the cup never showed up before the approach timed out.
+    // With scanFirst the cup can be anywhere in the arc in front of the robot,
+    // otherwise it has to be dead ahead.
+    bool runPickup(bool scanFirst);
+    // Returns false if the boxes never showed up before the approach timed
+    // out, in which case the cup is still in the claw. Without waitForElevator
+    // it returns as soon as the robot has backed out, with the elevator still
+    // on its way down to pickup height, so the next approach can start right
+    // away.
+    bool runAutoPlace(double placeHeightMM, bool waitForElevator);
+
+    // The two legs from the start tile to the cup pads, leaving the robot
+    // facing the cups
+    void driveToCups();
+    // The graded auto: out to the pads, pick up the cup in front and place it
+    // in the box to the left. Returns whether the cup was placed.
+    bool runMainAuto();
+    // Scores cups in queue order. A cup that can't be found is dropped and its
+    // box slot goes to the next cup. If a cup can't be placed the robot is
+    // still holding it, so the pipeline stops there rather than opening the
+    // claw for the next pickup. Check hasDistinctSlots() first. Returns cups
+    // scored per minute.
+    double runCupPipeline(std::deque<CupTarget> cups,
+      std::deque<BoxSlot> slots);
+
+  private:
+    SensorSource& sensors;
+    RoutineRobot& robot;
+    const RoutineSettings& settings;
+    RoutineGains gains;
+    PolarScan cupScan;
+  };
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: runlog.h
+// Description: Keeps a routine's run history on the SD card, so success rate
+// and cycle-time percentiles build up across power cycles instead of starting
+// over with every match.
+
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+#include "lib/stats.h"
+#include "vex.h"
+
+namespace lib {
+  class RunLog {
+  public:
+    // History goes to <name>_runs.bin
+    RunLog(const std::string& name);
+
+    // Adds the runs saved by earlier sessions. Returns false if there were
+    // none or the file is unreadable, in which case recording starts it over.
+    bool load();
+    // Counts the run and appends it to the SD card straight away, so nothing
+    // is lost if the robot is switched off mid-session
+    void record(double durationMS, bool success);
+    void printTelemetry();
+
+    RunStats& getStats();
+
+  private:
+    const std::string FILE_NAME;
+
+    RunStats stats;
+    // Set once the file on the card starts with a valid header
+    bool fileReady;
+
+    std::string labelRuns;
+    std::string labelSuccessRate;
+    std::string labelP50;
+    std::string labelP95;
+    std::string labelP99;
+    std::string labelExpected;
+  };
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: scan.h
+// Description: Polar range histogram built from distance readings taken while
+// the robot sweeps through an arc, used to find the bearing of a cup.
+
+#pragma once
+
+#include <vector>
+
+namespace lib {
+  struct ScanTarget {
+    // Relative to the heading the scan was centered on, clockwise positive
+    double bearingDegrees;
+    double rangeMM;
+    double widthMM;
+  };
+
+  class PolarScan {
+  public:
+    // Covers [-halfArcDegrees, halfArcDegrees] in bins of binDegrees. Each
+    // reading is taken to belong latencyDegrees before the bearing it is
+    // added at, since the sensor reports a little late while sweeping.
+    PolarScan(double halfArcDegrees, double binDegrees, double latencyDegrees);
+
+    void clear();
+    // Keeps the closest reading seen in each bin
+    void addSample(double bearingDegrees, double rangeMM);
+
+    // Groups neighbouring bins at a similar range into returns and picks the
+    // closest one whose width fits between minWidthMM and maxWidthMM, once
+    // the sensor's beam width is taken off. Returns false if none fit.
+    bool findNearest(double minWidthMM, double maxWidthMM, 
+      double beamWidthDegrees, ScanTarget& target);
+
+  private:
+    // Readings that jump by more than this belong to different objects
+    static constexpr double SAME_OBJECT_MM = 60.0;
+    // Distance sensor reports 9999 mm when there is nothing in range
+    static constexpr double NO_RETURN_MM = 2000.0;
+
+    const double HALF_ARC_DEGREES;
+    const double BIN_DEGREES;
+    const double LATENCY_DEGREES;
+
+    std::vector<double> rangesMM;
+
+    double binBearing(int bin);
+  };
+}
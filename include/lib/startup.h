@@ -0,0 +1,66 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: startup.h
+// Description: Runs initialization tasks side by side and waits for all of
+// them. A task can wait for others to finish before it starts, so startup
+// takes as long as the slowest chain of tasks rather than the sum of all of
+// them.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "vex.h"
+
+namespace lib {
+  class Startup {
+  public:
+    // Returns whether the task succeeded
+    typedef bool (*TaskFunction)();
+
+    const std::string NAME;
+
+    Startup(const std::string& name);
+
+    // The task starts once every task in after has finished or been cut off,
+    // and its timeout counts from then. Only tasks added earlier can go in
+    // after. Returns the task's index.
+    int addTask(const std::string& name, TaskFunction function, double timeoutMS,
+      const std::vector<int>& after = std::vector<int>());
+
+    // Starts each task on its own thread as soon as it is free to and blocks
+    // until every one has finished or run out of time. Tasks that time out
+    // are interrupted. Returns true only if every task succeeded in time.
+    bool run();
+    void printTelemetry();
+
+  private:
+    struct Task {
+      TaskFunction function;
+      double timeoutMS;
+      std::vector<int> after;
+
+      vex::thread* thread;
+      double startMS;
+      volatile bool done;
+      bool succeeded;
+      bool timedOut;
+      double durationMS;
+
+      std::string labelDuration;
+      std::string labelSucceeded;
+    };
+
+    std::vector<Task> tasks;
+    double totalMS;
+
+    std::string labelTotal = NAME + "/TOTAL_MS";
+
+    bool isFinished(const Task& task);
+    static int runTask(void* task);
+  };
+}
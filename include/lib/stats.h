@@ -0,0 +1,59 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: stats.h
+// Description: Tracks how often a routine succeeds and how long it takes. Free
+// of device calls so the host-side tools can report the same numbers.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace lib {
+  class RunStats {
+  public:
+    const std::string NAME;
+
+    RunStats(const std::string& name);
+
+    void record(double durationMS, bool success);
+
+    int runCount();
+    double successRate();
+    // Cycle time of successful runs at the given percentile (0 to 100), using
+    // the nearest-rank method
+    double percentileMS(double percentile);
+    // Mean time spent per success, counting the time lost to failed runs
+    double expectedMSPerSuccess();
+
+  private:
+    std::vector<double> successDurationsMS;
+    int failures;
+    double totalMS;
+  };
+
+  // Layout of the <name>_runs.bin files RunLog keeps on the SD card
+  struct RunLogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+  };
+
+  struct RunLogRecord {
+    float durationMS;
+    uint32_t success;
+  };
+
+  // "SPRN" in ASCII
+  const uint32_t RUN_LOG_MAGIC = 0x5350524E;
+  const uint16_t RUN_LOG_VERSION = 1;
+
+  // Adds every whole record in a run log's contents to stats. Returns how many
+  // bytes that covered, so a record cut short by a power loss can be trimmed
+  // off, or -1 if the header isn't a current run log.
+  int32_t addRunLog(const uint8_t* contents, int32_t size, RunStats& stats);
+}
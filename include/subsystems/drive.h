@@ -9,6 +9,10 @@
 #pragma once
 
 #include "lib/subsystem.h"
+#include "lib/feedforward.h"
+#include "lib/config.h"
+#include "lib/frame.h"
+#include "geometry.h"
 #include "vex.h"
 
 namespace subsystems {
@@ -18,7 +22,8 @@ namespace subsystems {
       std::string& name,
       vex::motor& leftMotorReference, 
       vex::motor& rightMotorReference, 
-      vex::inertial& inertialSensorReference);
+      vex::inertial& inertialSensorReference,
+      lib::SensorSource& sensorSourceReference);
 
     void periodic() override;
     void printTelemetry() override;
@@ -30,23 +35,92 @@ namespace subsystems {
       vex::distanceUnits units, bool blocking);
     void turnToAngle(vex::turnType direction, double angle, 
       vex::rotationUnits units, bool blocking);
+    // Turns the short way around to an absolute inertial heading
+    void turnToHeading(double headingDegrees);
+    // Rotates in place at a steady rate until told otherwise, clockwise
+    // positive
+    void spinInPlace(double degreesPerSec);
+
+    // Closed-loop wheel velocity in voltage mode using the characterized
+    // feedforward, acceleration is only used for feedforward
+    void setVelocityMMPerSec(double leftVelocity, double rightVelocity,
+      double leftAcceleration, double rightAcceleration);
+
+    // Runs a quasistatic ramp forward and a voltage step backward, fits the
+    // feedforward for each side and saves it to the SD card. Needs a few
+    // meters of clear space in front of the robot.
+    bool characterize();
+    // Loads gains saved by characterize(), returns false if there are none
+    bool loadCharacterization();
+    bool isCharacterized();
 
     double getHeadingDegrees();
+    // Unwrapped heading, keeps counting past 360
+    double getRotationDegrees();
 
   private:
     vex::motor& leftMotor;
     vex::motor& rightMotor;
     vex::inertial& inertialSensor;
+    // Profiled loops read through this so every tick they run on can be
+    // recorded and replayed
+    lib::SensorSource& sensorSource;
 
     // Constants for the drive
-    const double WHEEL_CIRCUMFERENCE = 319.19;
-    const double TRACK_WIDTH = 320.0;
-    const double WHEEL_BASE = 120;
+    const double WHEEL_CIRCUMFERENCE = geometry::WHEEL_CIRCUMFERENCE_MM;
+    const double TRACK_WIDTH = geometry::TRACK_WIDTH_MM;
+    const double WHEEL_BASE = geometry::WHEEL_BASE_MM;
     // Units are defined here, so no need to include them in variable name as
     // long as the units are consistent across everything.
     const vex::distanceUnits UNITS = vex::mm;
-    const double EXTERNAL_GEAR_RATIO = 1;
+    const double EXTERNAL_GEAR_RATIO = geometry::EXTERNAL_GEAR_RATIO;
+
+    // Gains are fit against this so they hold as the battery sags
+    const double NOMINAL_BATTERY_VOLTS = 12.0;
+    const double MAX_VOLTS = 12.0;
+    const double CONTROL_PERIOD_MS = 10.0;
+    // Wheel surface speed for 1 deg/s of rotation in place
+    const double MM_PER_DEGREE = TRACK_WIDTH / 2.0 * M_PI / 180.0;
+    // 200 RPM cartridge at the wheel, only used before characterization
+    const double FREE_SPEED_MM_PER_SEC = 200.0 / 60.0 * WHEEL_CIRCUMFERENCE;
+
+    const double QUASISTATIC_RAMP_VOLTS_PER_SEC = 1.0;
+    const double QUASISTATIC_MAX_VOLTS = 6.0;
+    const double STEP_VOLTS = 6.0;
+    const double STEP_DURATION_MS = 1500.0;
+    const std::string CHARACTERIZATION_FILE = "drive_gains.bin";
+    const uint32_t CHARACTERIZATION_VERSION = 1;
 
     vex::smartdrive robotDrive;
+
+    lib::Feedforward leftFeedforward;
+    lib::Feedforward rightFeedforward;
+    bool characterized;
+    lib::ConfigFile characterizationFile;
+
+    std::string labelLeftVelocity = lib::Subsystem::NAME + "/LEFT_VELOCITY_MMPS";
+    std::string labelRightVelocity = lib::Subsystem::NAME + "/RIGHT_VELOCITY_MMPS";
+    std::string labelLeftKS = lib::Subsystem::NAME + "/LEFT_KS";
+    std::string labelLeftKV = lib::Subsystem::NAME + "/LEFT_KV";
+    std::string labelLeftKA = lib::Subsystem::NAME + "/LEFT_KA";
+    std::string labelRightKS = lib::Subsystem::NAME + "/RIGHT_KS";
+    std::string labelRightKV = lib::Subsystem::NAME + "/RIGHT_KV";
+    std::string labelRightKA = lib::Subsystem::NAME + "/RIGHT_KA";
+
+    void driveProfiledMM(double distanceMM);
+    // Positive is clockwise, matching the inertial sensor
+    void turnProfiledDegrees(double angleDegrees);
+    // Same as the public one, with velocities already measured
+    void setVelocityMMPerSec(double leftVelocity, double rightVelocity,
+      double leftAcceleration, double rightAcceleration,
+      double measuredLeftVelocity, double measuredRightVelocity);
+    void setVoltage(double leftVolts, double rightVolts);
+    void saveCharacterization();
+
+    double getVelocityMMPerSec(vex::motor& motor);
+    double degreesToMM(double motorDegrees);
+    double rpmToMMPerSec(double motorRPM);
+    double batteryScale();
+    double toMM(double distance, vex::distanceUnits units);
   };
-}
\ No newline at end of file
+}
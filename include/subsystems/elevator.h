@@ -11,6 +11,7 @@
 #include "lib/subsystem.h"
 #include "cmath"
 #include "vex.h"
+#include "tuning.h"
 
 namespace subsystems {
   class Elevator : public lib::Subsystem {
@@ -18,8 +19,8 @@ namespace subsystems {
     Elevator(
       std::string& name,
       vex::motor& motorReference, 
-      vex::digital_in& limitSwitchUpperReference,
-      vex::digital_in& limitSwitchLowerReference);
+      vex::limit& limitSwitchUpperReference,
+      vex::limit& limitSwitchLowerReference);
 
     void periodic() override;
     void printTelemetry() override;
@@ -27,16 +28,45 @@ namespace subsystems {
 
     void setPositionMM(double targetHeightMM, bool blocking);
     void setVoltage(vex::directionType direction, double voltage);
+    // Hooks the limit switches up to stop the motor the moment they close.
+    // Call from main(), the event system isn't up yet during static init.
+    void registerLimitCallbacks();
 
     double getPositionMM();
     bool atTarget();
+    // True once the lower limit switch has zeroed the encoder
+    bool isHomed();
+    // Lowers the elevator slowly onto the lower limit switch, which zeroes
+    // the encoder. Returns false if the switch wasn't hit within
+    // getHomingTimeoutMS().
+    bool home();
+    // Long enough to come down the full travel at homing speed
+    double getHomingTimeoutMS();
 
   private:
     vex::motor& motor;
-    vex::digital_in& limitSwitchUpper;
-    vex::digital_in& limitSwitchLower;
+    vex::limit& limitSwitchUpper;
+    vex::limit& limitSwitchLower;
 
-    const double TOLERANCE_MM = 1;
+    // Limit switch callbacks are plain function pointers, so they need a way
+    // back to the elevator. There is only ever one elevator on the robot.
+    static Elevator* instance;
+    static void onUpperPressed();
+    static void onLowerPressed();
+
+    // Set from the limit switch callbacks and only cleared once the elevator
+    // is commanded away from the switch that was hit
+    volatile bool upperFault;
+    volatile bool lowerFault;
+    volatile bool homed;
+
+    const double TOLERANCE_MM = tuning::ELEVATOR_TOLERANCE_MM;
+    const double HOMING_VOLTS = 3.0;
+    // Full travel of the carriage, a little past the top box clearance
+    const double TRAVEL_MM = 620.0;
+    // Conservative for 3 V on an 18:1 cartridge, which is about 130 mm/s
+    // unloaded
+    const double HOMING_SPEED_MM_PER_SEC = 80.0;
     const double PITCH_MM = 12.7;
     const double TEETH = 12;
     const double PI = 3.14159265;
@@ -47,11 +77,17 @@ namespace subsystems {
     std::string labelAtTarget = lib::Subsystem::NAME + "/AT_TARGET";
     std::string labelAtUpper = lib::Subsystem::NAME + "/AT_UPPER";
     std::string labelAtLower = lib::Subsystem::NAME + "/AT_LOWER";
+    std::string labelUpperFault = lib::Subsystem::NAME + "/UPPER_FAULT";
+    std::string labelLowerFault = lib::Subsystem::NAME + "/LOWER_FAULT";
+    std::string labelHomed = lib::Subsystem::NAME + "/HOMED";
 
     double heightSetpointMM;
     
     bool atUpperBound();
     bool atLowerBound();
+    // Refuses to move further into a latched limit, clears the latch when
+    // moving away from it. Returns false if the move is blocked.
+    bool allowMove(bool movingUp);
 
     double mmToDegrees(double mm);
     double degreesToMM(double degrees);
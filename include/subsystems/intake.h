@@ -28,6 +28,9 @@ namespace subsystems {
 
     double getPositionRotations();
     bool touchingSurface();
+    // Closes the claw gently against its hard stop and calls that zero.
+    // Returns false if it never stalled in time.
+    bool zero(double timeoutMS);
     
   private:
     vex::motor& motor;
@@ -39,5 +42,10 @@ namespace subsystems {
     std::string labelTouchingSurface = lib::Subsystem::NAME + "/TOUCHING_SURFACE";
 
     double positionSetpointRotations;
+
+    const double ZEROING_VOLTS = 2.0;
+    // Ignore the stall check while the motor is still getting going
+    const double ZEROING_SPIN_UP_MS = 150.0;
+    const double STALLED_RPM = 2.0;
   };
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: tuning.h
+// Description: Every hand-tuned speed, gain and threshold in one place. Keep
+// this file to plain constants so it can be regenerated from a tuning run.
+
+#pragma once
+
+namespace tuning {
+  // Drive speed while creeping toward a cup or box with the distance sensor
+  const double DRIVE_SPEED_PCT = 20.0;
+  // Drive speed for fixed-distance legs
+  const double DRIVE_DISTANCE_SPEED_PCT = 30.0;
+
+  // Limits for profiled fixed-distance legs once the drive is characterized
+  const double DRIVE_MAX_VELOCITY_MM_PER_SEC = 700.0;
+  const double DRIVE_MAX_ACCELERATION_MM_PER_SEC2 = 1200.0;
+  // Volts per mm/s of wheel velocity error
+  const double DRIVE_VELOCITY_KP = 0.002;
+  // mm/s of correction per mm the wheels fall behind the profile
+  const double DRIVE_POSITION_KP = 3.0;
+  const double DRIVE_POSITION_TOLERANCE_MM = 5.0;
+  // How long past the end of the profile to wait for the wheels to settle
+  const double DRIVE_SETTLE_TIMEOUT_MS = 750.0;
+
+  // Limits for profiled turns on the inertial sensor
+  const double TURN_MAX_VELOCITY_DEG_PER_SEC = 360.0;
+  const double TURN_MAX_ACCELERATION_DEG_PER_SEC2 = 720.0;
+  // deg/s of correction per degree of heading error
+  const double TURN_KP = 4.0;
+  const double TURN_KI = 0.0;
+  const double TURN_KD = 0.1;
+  // A turn is done once it is both on heading and no longer rotating
+  const double TURN_TOLERANCE_DEG = 1.0;
+  const double TURN_RATE_TOLERANCE_DEG_PER_SEC = 5.0;
+  const double TURN_SETTLE_TIMEOUT_MS = 750.0;
+
+  // Sweep used to find a cup that isn't dead ahead
+  const double SCAN_HALF_ARC_DEG = 45.0;
+  const double SCAN_BIN_DEG = 2.0;
+  const double SCAN_RATE_DEG_PER_SEC = 60.0;
+  // The distance sensor reports a little late and sees a cone, not a ray
+  const double SCAN_SENSOR_LATENCY_MS = 40.0;
+  const double SCAN_BEAM_WIDTH_DEG = 8.0;
+  const double CUP_MIN_WIDTH_MM = 40.0;
+  const double CUP_MAX_WIDTH_MM = 150.0;
+  // Stop the quick approach this far short and creep the rest of the way
+  const double SCAN_APPROACH_MARGIN_MM = 60.0;
+
+  // Current shared between all motors by the motor budget, well under what
+  // the brain allows so the motors stay cool over a long session
+  const double MOTOR_BUDGET_TOTAL_AMPS = 8.0;
+  // Least each motor is held at once it stops. A motor that measures a
+  // bigger holding draw, like a loaded elevator, is held at that instead.
+  const double INTAKE_HOLD_CURRENT_AMPS = 0.4;
+  const double ELEVATOR_HOLD_CURRENT_AMPS = 0.8;
+  const double DRIVE_HOLD_CURRENT_AMPS = 0.2;
+  // Relative share of the budget each motor gets while it is moving
+  const double DRIVE_BUDGET_PRIORITY = 3.0;
+  const double ELEVATOR_BUDGET_PRIORITY = 2.0;
+  const double INTAKE_BUDGET_PRIORITY = 1.0;
+
+  // How close the elevator has to be to its setpoint to count as there, and
+  // for a blocking move to hand back
+  const double ELEVATOR_TOLERANCE_MM = 1.0;
+
+  // Distance sensor readings that end each approach
+  const double PICKUP_DISTANCE_MM = 77.0;
+  const double PREP_PLACE_DISTANCE_MM = 270.0;
+  const double PLACE_DISTANCE_MM = 17.0;
+  // Give up on an approach if nothing shows up in front of the robot by then.
+  // Approaches used to creep on until something did, keep that in mind when
+  // slowing DRIVE_SPEED_PCT.
+  const double APPROACH_TIMEOUT_MS = 6000.0;
+}
@@ -0,0 +1,138 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: knobs.cpp
+// Description: The constants in tuning.h the host tools know how to vary, and
+// how to read them back out of a tuning.h. Also reads and writes the
+// routine.bin the robot keeps its calibrated settings in.
+
+#include "knobs.h"
+#include "lib/configblock.h"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace sim {
+  // Ranges keep the prep distance above the place distance, so every
+  // candidate is a valid routine.bin
+  const Knob KNOBS[] = {
+    {"DRIVE_SPEED_PCT", 10.0, 50.0, 1, true,
+      [](const Params& p) -> double { return p.routine.approachSpeedPct; },
+      [](Params& p, double value) { p.routine.approachSpeedPct = value; }},
+    {"DRIVE_DISTANCE_SPEED_PCT", 15.0, 80.0, 1, false,
+      [](const Params& p) -> double { return p.driveDistanceSpeedPct; },
+      [](Params& p, double value) { p.driveDistanceSpeedPct = value; }},
+    {"DRIVE_MAX_VELOCITY_MM_PER_SEC", 300.0, 950.0, 1, true,
+      [](const Params& p) -> double { return p.drive.maxVelocityMMPerSec; },
+      [](Params& p, double value) { p.drive.maxVelocityMMPerSec = value; }},
+    {"DRIVE_MAX_ACCELERATION_MM_PER_SEC2", 400.0, 3000.0, 1, true,
+      [](const Params& p) -> double {
+        return p.drive.maxAccelerationMMPerSec2;
+      },
+      [](Params& p, double value) {
+        p.drive.maxAccelerationMMPerSec2 = value;
+      }},
+    {"DRIVE_VELOCITY_KP", 0.0, 0.01, 4, false,
+      [](const Params& p) -> double { return p.driveVelocityKP; },
+      [](Params& p, double value) { p.driveVelocityKP = value; }},
+    {"DRIVE_POSITION_KP", 0.0, 10.0, 2, false,
+      [](const Params& p) -> double { return p.drive.positionKP; },
+      [](Params& p, double value) { p.drive.positionKP = value; }},
+    {"TURN_MAX_VELOCITY_DEG_PER_SEC", 90.0, 540.0, 1, true,
+      [](const Params& p) -> double { return p.turn.maxVelocityDegPerSec; },
+      [](Params& p, double value) { p.turn.maxVelocityDegPerSec = value; }},
+    {"TURN_MAX_ACCELERATION_DEG_PER_SEC2", 180.0, 2000.0, 1, true,
+      [](const Params& p) -> double {
+        return p.turn.maxAccelerationDegPerSec2;
+      },
+      [](Params& p, double value) {
+        p.turn.maxAccelerationDegPerSec2 = value;
+      }},
+    {"TURN_KP", 0.5, 12.0, 2, false,
+      [](const Params& p) -> double { return p.turn.kP; },
+      [](Params& p, double value) { p.turn.kP = value; }},
+    {"TURN_KD", 0.0, 0.5, 3, false,
+      [](const Params& p) -> double { return p.turn.kD; },
+      [](Params& p, double value) { p.turn.kD = value; }},
+    {"SCAN_RATE_DEG_PER_SEC", 20.0, 150.0, 1, true,
+      [](const Params& p) -> double { return p.routine.scanRateDegPerSec; },
+      [](Params& p, double value) { p.routine.scanRateDegPerSec = value; }},
+    {"SCAN_APPROACH_MARGIN_MM", 20.0, 200.0, 1, false,
+      [](const Params& p) -> double { return p.routine.scanApproachMarginMM; },
+      [](Params& p, double value) { p.routine.scanApproachMarginMM = value; }},
+    {"ELEVATOR_TOLERANCE_MM", 0.5, 5.0, 1, false,
+      [](const Params& p) -> double { return p.elevatorToleranceMM; },
+      [](Params& p, double value) { p.elevatorToleranceMM = value; }},
+    {"PICKUP_DISTANCE_MM", 40.0, 120.0, 1, false,
+      [](const Params& p) -> double { return p.settings.pickupDistanceMM; },
+      [](Params& p, double value) {
+        p.settings.pickupDistanceMM = (float) value;
+      }},
+    {"PREP_PLACE_DISTANCE_MM", 150.0, 400.0, 1, false,
+      [](const Params& p) -> double { return p.settings.prepPlaceDistanceMM; },
+      [](Params& p, double value) {
+        p.settings.prepPlaceDistanceMM = (float) value;
+      }},
+    {"PLACE_DISTANCE_MM", 5.0, 75.0, 1, false,
+      [](const Params& p) -> double { return p.settings.placeDistanceMM; },
+      [](Params& p, double value) {
+        p.settings.placeDistanceMM = (float) value;
+      }},
+  };
+  extern const int KNOB_COUNT = sizeof(KNOBS) / sizeof(KNOBS[0]);
+
+  bool readTuning(const std::string& path, Params& params) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+      return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+      for (int k = 0; k < KNOB_COUNT; k++) {
+        std::string declaration = std::string("const double ") + KNOBS[k].name
+          + " = ";
+        size_t start = line.find(declaration);
+        if (start != std::string::npos) {
+          KNOBS[k].set(params,
+            atof(line.c_str() + start + declaration.size()));
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool readSettings(const std::string& path, lib::RoutineSettings& settings) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::vector<uint8_t> contents((std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>());
+
+    lib::RoutineSettings loaded;
+    if (!lib::unpackConfig(contents, lib::ROUTINE_SETTINGS_VERSION, &loaded,
+        sizeof(lib::RoutineSettings))
+        || !lib::isValidRoutineSettings(loaded)) {
+      return false;
+    }
+    settings = loaded;
+    return true;
+  }
+
+  bool writeSettings(const std::string& path,
+    const lib::RoutineSettings& settings) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out) {
+      return false;
+    }
+    std::vector<uint8_t> contents = lib::packConfig(
+      lib::ROUTINE_SETTINGS_VERSION, &settings, sizeof(lib::RoutineSettings));
+    out.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+    return (bool) out;
+  }
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: knobs.h
+// Description: The constants in tuning.h the host tools know how to vary, and
+// how to read them back out of a tuning.h. Also reads and writes the
+// routine.bin the robot keeps its calibrated settings in.
+
+#pragma once
+
+#include "robot.h"
+#include <string>
+
+namespace sim {
+  struct Knob {
+    // Name of the constant in tuning.h
+    const char* name;
+    // Range the tuner searches
+    double low;
+    double high;
+    // Decimal places the value is written out with
+    int decimals;
+    // Part of the tuner's coarse grid, the rest stay put until the second
+    // stage
+    bool grid;
+    double (*get)(const Params&);
+    void (*set)(Params&, double);
+  };
+
+  extern const Knob KNOBS[];
+  extern const int KNOB_COUNT;
+
+  // Sets every knob found in the tuning.h at path, leaving the rest alone.
+  // Returns false if the file can't be read.
+  bool readTuning(const std::string& path, Params& params);
+
+  // Same checks the robot makes when it loads the file, so a file the robot
+  // would ignore is refused here too
+  bool readSettings(const std::string& path, lib::RoutineSettings& settings);
+  bool writeSettings(const std::string& path,
+    const lib::RoutineSettings& settings);
+}
@@ -0,0 +1,245 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: montecarlo.cpp
+// Description: Runs the autonomous routines thousands of times over
+// randomized worlds, each with its own start pose, cup and box placement,
+// sensor noise and motor spread, and reports how often they succeed and how
+// long they take. Numbers come from the same RunStats the robot keeps, so they
+// line up with what the brain prints, and --field puts the robot's own run
+// history next to them to check the simulation against.
+//
+// Usage: montecarlo [--runs N] [--routine main|pickup|place|all]
+//                   [--threads N] [--seed N] [--tuning tuning.h]
+//                   [--settings routine.bin] [--field DIR]
+
+#include "robot.h"
+#include "knobs.h"
+#include "pool.h"
+#include "lib/stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct Options {
+  int runs = 2000;
+  std::string routine = "all";
+  int threads = 0;
+  uint32_t seed = 1;
+  // Scored against the tuning.h this was built with when given
+  std::string tuning;
+  // The robot's calibrated settings, every candidate runs with them
+  std::string settings;
+  // Folder holding the *_runs.bin files copied off the robot's SD card
+  std::string field;
+};
+
+struct Routine {
+  const char* name;
+  sim::RunResult (*run)(uint32_t seed, const sim::Params& params);
+  bool (*succeeded)(const sim::RunResult& result);
+  double (*durationMS)(const sim::RunResult& result);
+  // Where the robot keeps its own runs of the routine, if it times it
+  const char* fieldLog;
+};
+
+const Routine ROUTINES[] = {
+  {"main", sim::runMainAuto,
+    [](const sim::RunResult& r) { return r.pickedUp && r.placed; },
+    [](const sim::RunResult& r) { return r.totalMS; }, NULL},
+  {"pickup", sim::runPickupTrial,
+    [](const sim::RunResult& r) { return r.pickedUp; },
+    [](const sim::RunResult& r) { return r.pickupMS; }, "pickup_runs.bin"},
+  {"place", sim::runPlaceTrial,
+    [](const sim::RunResult& r) { return r.pickedUp && r.placed; },
+    [](const sim::RunResult& r) { return r.placeMS; }, "place_runs.bin"},
+};
+const int ROUTINE_COUNT = sizeof(ROUTINES) / sizeof(ROUTINES[0]);
+
+// Why runs went wrong, a run can land in more than one
+struct Failures {
+  int missedCup;
+  int droppedCup;
+  int knockedCup;
+  int collisions;
+};
+
+// How far apart two success rates can be before it's more than the luck of
+// the draw, in standard errors
+const double CALIBRATION_SIGMAS = 2.0;
+
+void printStats(const char* label, lib::RunStats& stats) {
+  printf("%-7s %-9s success %5.1f%%  p50 %6.2f s  p95 %6.2f s  "
+    "p99 %6.2f s  per success %6.2f s\n", stats.NAME.c_str(), label,
+    stats.successRate() * 100.0, stats.percentileMS(50.0) / 1000.0,
+    stats.percentileMS(95.0) / 1000.0, stats.percentileMS(99.0) / 1000.0,
+    stats.expectedMSPerSuccess() / 1000.0);
+}
+
+// Returns what the runs scored, for checking against the field
+lib::RunStats report(const char* label, const Routine& routine,
+  const std::vector<sim::RunResult>& results) {
+  lib::RunStats stats(routine.name);
+  Failures failures = Failures();
+  for (const sim::RunResult& result : results) {
+    stats.record(routine.durationMS(result), routine.succeeded(result));
+    if (!result.pickedUp) {
+      failures.missedCup++;
+    } else if (routine.run != sim::runPickupTrial && !result.placed) {
+      failures.droppedCup++;
+    }
+    if (result.cupKnocked) {
+      failures.knockedCup++;
+    }
+    if (result.wallContacts > 0) {
+      failures.collisions++;
+    }
+  }
+
+  printStats(label, stats);
+  printf("%-7s %-9s missed %d  dropped %d  knocked %d  collisions %d\n", "",
+    "", failures.missedCup, failures.droppedCup, failures.knockedCup,
+    failures.collisions);
+  return stats;
+}
+
+// Reads a run log the robot wrote, the same way it reads it back at startup
+bool loadFieldRuns(const std::string& path, lib::RunStats& stats) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::vector<uint8_t> contents((std::istreambuf_iterator<char>(in)),
+    std::istreambuf_iterator<char>());
+  return lib::addRunLog(contents.data(), contents.size(), stats) >= 0
+    && stats.runCount() > 0;
+}
+
+// The shipped values against the robot's history with them. The world's
+// spreads in world.h and robot.cpp are estimates, this is what says whether
+// they are the right ones.
+void checkAgainstField(const Routine& routine, lib::RunStats& simulated,
+  const Options& options) {
+  lib::RunStats field(routine.name);
+  std::string path = options.field + "/" + routine.fieldLog;
+  if (!loadFieldRuns(path, field)) {
+    printf("%-7s %-9s no runs in %s\n", "", "", path.c_str());
+    return;
+  }
+  printStats("field", field);
+
+  double fieldRate = field.successRate();
+  double simulatedRate = simulated.successRate();
+  double pooled = (fieldRate * field.runCount()
+    + simulatedRate * simulated.runCount())
+    / (field.runCount() + simulated.runCount());
+  double standardError = std::sqrt(pooled * (1.0 - pooled)
+    * (1.0 / field.runCount() + 1.0 / simulated.runCount()));
+  if (std::fabs(simulatedRate - fieldRate)
+      > CALIBRATION_SIGMAS * standardError) {
+    printf("%-7s %-9s success %+.1f points off the field's %d runs, "
+      "recalibrate the world\n", "", "", (simulatedRate - fieldRate) * 100.0,
+      field.runCount());
+  }
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (strcmp(argv[i - 1], "--runs") == 0) {
+      options.runs = std::max(1, atoi(value));
+    } else if (strcmp(argv[i - 1], "--routine") == 0) {
+      options.routine = value;
+    } else if (strcmp(argv[i - 1], "--threads") == 0) {
+      options.threads = atoi(value);
+    } else if (strcmp(argv[i - 1], "--seed") == 0) {
+      options.seed = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i - 1], "--tuning") == 0) {
+      options.tuning = value;
+    } else if (strcmp(argv[i - 1], "--settings") == 0) {
+      options.settings = value;
+    } else if (strcmp(argv[i - 1], "--field") == 0) {
+      options.field = value;
+    } else {
+      return false;
+    }
+  }
+
+  if (options.routine == "all") {
+    return true;
+  }
+  for (int r = 0; r < ROUTINE_COUNT; r++) {
+    if (options.routine == ROUTINES[r].name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "Usage: %s [--runs N] [--routine main|pickup|place|all] "
+      "[--threads N] [--seed N] [--tuning tuning.h] "
+      "[--settings routine.bin] [--field DIR]\n", argv[0]);
+    return 2;
+  }
+  std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+  printf("%d runs per routine on %d threads\n", options.runs,
+    sim::threadCount(options.threads));
+
+  sim::Params current = sim::defaultParams();
+  if (!options.settings.empty()
+      && !sim::readSettings(options.settings, current.settings)) {
+    fprintf(stderr, "Can't read %s\n", options.settings.c_str());
+    return 1;
+  }
+  std::vector<sim::Params> candidates(1, current);
+  std::vector<const char*> labels(1, "current");
+  if (!options.tuning.empty()) {
+    sim::Params params = current;
+    if (!sim::readTuning(options.tuning, params)) {
+      fprintf(stderr, "Can't read %s\n", options.tuning.c_str());
+      return 1;
+    }
+    candidates.push_back(params);
+    labels.push_back("candidate");
+  }
+
+  // Every candidate sees the same worlds, so differences are down to the
+  // values and not the draw
+  for (int r = 0; r < ROUTINE_COUNT; r++) {
+    const Routine& routine = ROUTINES[r];
+    if (options.routine != "all" && options.routine != routine.name) {
+      continue;
+    }
+    for (size_t c = 0; c < candidates.size(); c++) {
+      std::vector<sim::RunResult> results(options.runs);
+      sim::parallelFor(options.runs, options.threads, [&](int i) {
+        results[i] = routine.run(options.seed + i, candidates[c]);
+      });
+      lib::RunStats stats = report(labels[c], routine, results);
+      if (c == 0 && !options.field.empty() && routine.fieldLog != NULL) {
+        checkAgainstField(routine, stats, options);
+      }
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - startTime).count();
+  printf("\nDone in %.0f s\n", seconds);
+  return 0;
+}
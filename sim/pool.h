@@ -0,0 +1,44 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: pool.h
+// Description: Runs independent jobs across every CPU core. Each job builds
+// its own World, so nothing is shared between threads but the job counter.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace sim {
+  // Defaults to one thread per core
+  inline int threadCount(int requested) {
+    if (requested > 0) {
+      return requested;
+    }
+    return std::max(1, (int) std::thread::hardware_concurrency());
+  }
+
+  // Calls job(i) for every i in [0, count), spread over threads. Jobs are
+  // handed out one at a time, so uneven run lengths still keep every core busy.
+  template <typename Job>
+  void parallelFor(int count, int threads, Job job) {
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    int workerCount = std::min(threadCount(threads), std::max(1, count));
+    for (int w = 0; w < workerCount; w++) {
+      workers.push_back(std::thread([&]() {
+        for (int i = next++; i < count; i = next++) {
+          job(i);
+        }
+      }));
+    }
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  }
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: replay.cpp
+// Description: Feeds a sensors.bin recorded on the robot back through the
+// current control code and reports where its outputs differ from what the
+// robot did, so two code versions can be compared on the same field run.
+//
+// Usage: replay <sensors.bin> [--frames]
+//   --frames  print every replayed frame as CSV instead of one line per loop
+
+#include "lib/frame.h"
+#include "lib/motion.h"
+#include "lib/scan.h"
+#include "lib/allocator.h"
+#include "geometry.h"
+#include "tuning.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Wheel surface speed for 1 deg/s of rotation in place, same as the drive's
+const double MM_PER_DEGREE = geometry::TRACK_WIDTH_MM / 2.0 * M_PI / 180.0;
+
+const char* MODE_NAMES[] = {"none", "drive", "turn", "scan", "approach"};
+
+struct Output {
+  double left;
+  double right;
+};
+
+bool loadLog(const char* path, std::vector<lib::SensorFrame>& frames) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Can't open %s\n", path);
+    return false;
+  }
+
+  lib::LogHeader header;
+  if (fread(&header, sizeof(lib::LogHeader), 1, file) != 1
+      || header.magic != lib::LOG_MAGIC || header.version != lib::LOG_VERSION
+      || header.frameSize != sizeof(lib::SensorFrame)) {
+    fprintf(stderr, "%s isn't a version %d sensor log\n", path,
+      lib::LOG_VERSION);
+    fclose(file);
+    return false;
+  }
+
+  // A partial frame at the end means power was cut mid-write, drop it
+  lib::SensorFrame frame;
+  while (fread(&frame, sizeof(lib::SensorFrame), 1, file) == 1) {
+    frames.push_back(frame);
+  }
+  fclose(file);
+  return true;
+}
+
+double degreesToMM(double motorDegrees) {
+  return motorDegrees / 360.0 / geometry::EXTERNAL_GEAR_RATIO
+    * geometry::WHEEL_CIRCUMFERENCE_MM;
+}
+
+double elapsedSeconds(const lib::SensorFrame& frame,
+  const lib::SensorFrame& start) {
+  return (frame.timestampMS - start.timestampMS) / 1000.0;
+}
+
+// Each replay mirrors the loop of the same mode on the robot. Drives and turns
+// measure from their first frame, which the robot logs before sending
+// anything, so it has no outputs to compare.
+std::vector<Output> replayDrive(const std::vector<lib::SensorFrame>& frames) {
+  std::vector<Output> outputs(1, Output());
+  const lib::SensorFrame& start = frames.front();
+  lib::ProfiledDrive controller(start.setpoint, lib::defaultDriveGains());
+  for (size_t i = 1; i < frames.size(); i++) {
+    const lib::SensorFrame& frame = frames[i];
+    lib::DriveCommand command = controller.calculate(
+      elapsedSeconds(frame, start),
+      degreesToMM(frame.leftPositionDegrees - start.leftPositionDegrees),
+      degreesToMM(frame.rightPositionDegrees - start.rightPositionDegrees));
+    outputs.push_back({
+      command.done ? 0.0 : command.leftVelocityMMPerSec,
+      command.done ? 0.0 : command.rightVelocityMMPerSec});
+  }
+  return outputs;
+}
+
+std::vector<Output> replayTurn(const std::vector<lib::SensorFrame>& frames) {
+  std::vector<Output> outputs(1, Output());
+  const lib::SensorFrame& start = frames.front();
+  lib::ProfiledTurn controller(start.setpoint, lib::defaultTurnGains());
+  for (size_t i = 1; i < frames.size(); i++) {
+    const lib::SensorFrame& frame = frames[i];
+    lib::TurnCommand command = controller.calculate(
+      elapsedSeconds(frame, start),
+      frame.rotationDegrees - start.rotationDegrees, frame.gyroRateDegPerSec);
+    double wheelVelocity =
+      command.done ? 0.0 : command.velocityDegPerSec * MM_PER_DEGREE;
+    outputs.push_back({wheelVelocity, -wheelVelocity});
+  }
+  return outputs;
+}
+
+std::vector<Output> replayScan(const std::vector<lib::SensorFrame>& frames) {
+  std::vector<Output> outputs;
+  double centerDegrees = frames.front().setpoint;
+  lib::PolarScan scan(tuning::SCAN_HALF_ARC_DEG, tuning::SCAN_BIN_DEG,
+    tuning::SCAN_RATE_DEG_PER_SEC * tuning::SCAN_SENSOR_LATENCY_MS / 1000.0);
+  for (const lib::SensorFrame& frame : frames) {
+    bool done =
+      frame.rotationDegrees >= centerDegrees + tuning::SCAN_HALF_ARC_DEG;
+    scan.addSample(frame.rotationDegrees - centerDegrees, frame.distanceMM);
+    double rate = done ? 0.0 : tuning::SCAN_RATE_DEG_PER_SEC;
+    outputs.push_back({rate, rate});
+  }
+
+  lib::ScanTarget target;
+  if (scan.findNearest(tuning::CUP_MIN_WIDTH_MM, tuning::CUP_MAX_WIDTH_MM,
+      tuning::SCAN_BEAM_WIDTH_DEG, target)) {
+    printf("  scan found a cup at %.1f deg, %.0f mm, %.0f mm wide\n",
+      target.bearingDegrees, target.rangeMM, target.widthMM);
+  } else {
+    printf("  scan found no cup\n");
+  }
+  return outputs;
+}
+
+std::vector<Output> replayApproach(const std::vector<lib::SensorFrame>& frames) {
+  std::vector<Output> outputs;
+  for (const lib::SensorFrame& frame : frames) {
+    double demand = lib::approachDemandPct(frame.distanceMM, frame.setpoint,
+      tuning::DRIVE_SPEED_PCT);
+    outputs.push_back({demand, demand});
+  }
+  return outputs;
+}
+
+// The budget runs on its own thread on the robot, so the limits it had
+// applied lag each frame a little. Differences well under an amp are that
+// lag, not a change in behavior.
+double replayBudget(const std::vector<lib::SensorFrame>& frames) {
+  lib::CurrentAllocator allocator(tuning::MOTOR_BUDGET_TOTAL_AMPS);
+  allocator.addMotor(tuning::DRIVE_BUDGET_PRIORITY,
+    tuning::DRIVE_HOLD_CURRENT_AMPS);
+  allocator.addMotor(tuning::DRIVE_BUDGET_PRIORITY,
+    tuning::DRIVE_HOLD_CURRENT_AMPS);
+  allocator.addMotor(tuning::ELEVATOR_BUDGET_PRIORITY,
+    tuning::ELEVATOR_HOLD_CURRENT_AMPS);
+  allocator.addMotor(tuning::INTAKE_BUDGET_PRIORITY,
+    tuning::INTAKE_HOLD_CURRENT_AMPS);
+
+  double maxDifference = 0.0;
+  std::vector<lib::MotorSample> samples(lib::FRAME_MOTOR_COUNT);
+  for (const lib::SensorFrame& frame : frames) {
+    for (int i = 0; i < lib::FRAME_MOTOR_COUNT; i++) {
+      samples[i].temperatureC = frame.motorTemperatureC[i];
+      samples[i].currentAmps = frame.motorCurrentAmps[i];
+      samples[i].velocityRPM = frame.motorVelocityRPM[i];
+    }
+    allocator.allocate(samples, frame.timestampMS);
+    for (int i = 0; i < lib::FRAME_MOTOR_COUNT; i++) {
+      maxDifference = std::fmax(maxDifference,
+        std::fabs(allocator.getLimitAmps(i) - frame.motorLimitAmps[i]));
+    }
+  }
+  return maxDifference;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <sensors.bin> [--frames]\n", argv[0]);
+    return 2;
+  }
+  bool printFrames = argc > 2 && strcmp(argv[2], "--frames") == 0;
+
+  std::vector<lib::SensorFrame> frames;
+  if (!loadLog(argv[1], frames)) {
+    return 1;
+  }
+  if (frames.empty()) {
+    printf("Log has no frames\n");
+    return 0;
+  }
+  printf("%zu frames over %.1f s\n", frames.size(),
+    elapsedSeconds(frames.back(), frames.front()));
+  if (printFrames) {
+    printf("time_ms,mode,run,recorded_left,replayed_left,"
+      "recorded_right,replayed_right\n");
+  }
+
+  // The recorder thread's frames land between a loop's own, so loops are
+  // pieced together from the control frames alone
+  std::vector<lib::SensorFrame> controlFrames;
+  for (const lib::SensorFrame& frame : frames) {
+    if (frame.controlMode != lib::CONTROL_NONE
+        && frame.controlMode <= lib::CONTROL_APPROACH) {
+      controlFrames.push_back(frame);
+    }
+  }
+
+  double maxDifference = 0.0;
+  size_t start = 0;
+  while (start < controlFrames.size()) {
+    // A loop's frames are the ones in a row that share its run number
+    size_t end = start;
+    while (end + 1 < controlFrames.size()
+        && controlFrames[end + 1].controlMode
+          == controlFrames[start].controlMode
+        && controlFrames[end + 1].controlRun
+          == controlFrames[start].controlRun) {
+      end++;
+    }
+    std::vector<lib::SensorFrame> loop(controlFrames.begin() + start,
+      controlFrames.begin() + end + 1);
+    start = end + 1;
+
+    uint8_t mode = loop.front().controlMode;
+
+    if (!printFrames) {
+      printf("%s run %d, setpoint %.1f, %zu frames\n", MODE_NAMES[mode],
+        loop.front().controlRun, loop.front().setpoint, loop.size());
+    }
+    std::vector<Output> outputs;
+    switch (mode) {
+      case lib::CONTROL_DRIVE:
+        outputs = replayDrive(loop);
+        break;
+      case lib::CONTROL_TURN:
+        outputs = replayTurn(loop);
+        break;
+      case lib::CONTROL_SCAN:
+        outputs = replayScan(loop);
+        break;
+      default:
+        outputs = replayApproach(loop);
+        break;
+    }
+
+    double loopDifference = 0.0;
+    for (size_t i = 0; i < loop.size(); i++) {
+      loopDifference = std::fmax(loopDifference, std::fmax(
+        std::fabs(outputs[i].left - loop[i].leftOutput),
+        std::fabs(outputs[i].right - loop[i].rightOutput)));
+      if (printFrames) {
+        printf("%u,%s,%d,%.2f,%.2f,%.2f,%.2f\n", loop[i].timestampMS,
+          MODE_NAMES[mode], loop[i].controlRun, loop[i].leftOutput,
+          outputs[i].left, loop[i].rightOutput, outputs[i].right);
+      }
+    }
+    if (!printFrames) {
+      printf("  largest output difference %.3f\n", loopDifference);
+    }
+    maxDifference = std::fmax(maxDifference, loopDifference);
+  }
+
+  printf("Largest control output difference: %.3f\n", maxDifference);
+  printf("Largest motor budget difference: %.3f A\n", replayBudget(frames));
+  return 0;
+}
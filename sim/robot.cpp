@@ -0,0 +1,308 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: robot.cpp
+// Description: The robot's own routines and profiled drive, run against a
+// simulated World. Only the device calls differ, the routines and
+// controllers are the same lib code the robot runs.
+
+#include "robot.h"
+#include "geometry.h"
+#include "tuning.h"
+#include <cmath>
+
+namespace sim {
+  // How far off its mark the robot is set down at the start of a run
+  const double START_JITTER_MM = 30.0;
+  const double START_JITTER_DEG = 3.0;
+
+  // The box face the routines place against
+  const double BOX_HALF_LENGTH_MM = 600.0;
+  const double BOX_SKEW_DEG = 8.0;
+
+  void addBoxAhead(World& world, double turnDegrees);
+
+  Params defaultParams() {
+    Params params;
+    params.driveDistanceSpeedPct = tuning::DRIVE_DISTANCE_SPEED_PCT;
+    params.elevatorToleranceMM = tuning::ELEVATOR_TOLERANCE_MM;
+    params.driveVelocityKP = tuning::DRIVE_VELOCITY_KP;
+    params.drive = lib::defaultDriveGains();
+    params.turn = lib::defaultTurnGains();
+    params.routine = lib::defaultRoutineGains();
+    params.settings = lib::defaultRoutineSettings();
+    return params;
+  }
+
+  SimRobot::SimRobot(World& worldReference, const Params& params)
+  : MM_PER_DEGREE(geometry::TRACK_WIDTH_MM / 2.0 * M_PI / 180.0),
+    FREE_SPEED_MM_PER_SEC(200.0 / 60.0 * geometry::WHEEL_CIRCUMFERENCE_MM),
+    world(worldReference),
+    params(params),
+    feedforward(NOMINAL_KS, NOMINAL_KV, NOMINAL_KA),
+    robotRoutines(worldReference, *this, this->params.settings,
+      params.routine),
+    runResult(RunResult()),
+    placedBefore(0),
+    boxAfterPickup(false),
+    boxTurnDegrees(0.0) {}
+
+  void SimRobot::driveDistance(double distanceMM, bool blocking) {
+    if (!blocking) {
+      world.driveFor(distanceMM,
+        params.driveDistanceSpeedPct / 100.0 * FREE_SPEED_MM_PER_SEC);
+      return;
+    }
+
+    lib::ProfiledDrive controller(distanceMM, params.drive);
+    lib::SensorFrame start = world.read();
+    double direction = distanceMM < 0.0 ? -1.0 : 1.0;
+
+    while (true) {
+      lib::SensorFrame frame = world.read();
+      double t = (frame.timestampMS - start.timestampMS) / 1000.0;
+      double leftTravel =
+        degreesToMM(frame.leftPositionDegrees - start.leftPositionDegrees);
+      double rightTravel =
+        degreesToMM(frame.rightPositionDegrees - start.rightPositionDegrees);
+      lib::DriveCommand command =
+        controller.calculate(t, leftTravel, rightTravel);
+
+      runResult.driveOvershootMM = std::fmax(runResult.driveOvershootMM,
+        direction * ((leftTravel + rightTravel) / 2.0 - distanceMM));
+      if (command.done) {
+        break;
+      }
+
+      setVelocityMMPerSec(
+        command.leftVelocityMMPerSec, command.rightVelocityMMPerSec,
+        command.accelerationMMPerSec2, command.accelerationMMPerSec2,
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_LEFT_DRIVE]),
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_RIGHT_DRIVE]));
+      wait(CONTROL_PERIOD_MS);
+    }
+    stopDrive();
+  }
+
+  void SimRobot::turnToAngle(double angleDegrees) {
+    lib::ProfiledTurn controller(angleDegrees, params.turn);
+    lib::SensorFrame start = world.read();
+    double direction = angleDegrees < 0.0 ? -1.0 : 1.0;
+
+    while (true) {
+      lib::SensorFrame frame = world.read();
+      double t = (frame.timestampMS - start.timestampMS) / 1000.0;
+      double turned = frame.rotationDegrees - start.rotationDegrees;
+      lib::TurnCommand command =
+        controller.calculate(t, turned, frame.gyroRateDegPerSec);
+
+      runResult.turnOvershootDegrees = std::fmax(
+        runResult.turnOvershootDegrees, direction * (turned - angleDegrees));
+      if (command.done) {
+        break;
+      }
+
+      double wheelVelocity = command.velocityDegPerSec * MM_PER_DEGREE;
+      double wheelAcceleration = command.accelerationDegPerSec2 * MM_PER_DEGREE;
+      setVelocityMMPerSec(wheelVelocity, -wheelVelocity,
+        wheelAcceleration, -wheelAcceleration,
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_LEFT_DRIVE]),
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_RIGHT_DRIVE]));
+      wait(CONTROL_PERIOD_MS);
+    }
+    stopDrive();
+  }
+
+  void SimRobot::turnToHeading(double headingDegrees) {
+    double error =
+      std::fmod(headingDegrees - world.read().headingDegrees, 360.0);
+    if (error >= 180.0) {
+      error -= 360.0;
+    } else if (error < -180.0) {
+      error += 360.0;
+    }
+    turnToAngle(error);
+  }
+
+  void SimRobot::spinInPlace(double degreesPerSec) {
+    double wheelVelocity = degreesPerSec * MM_PER_DEGREE;
+    lib::SensorFrame frame = world.read();
+    setVelocityMMPerSec(wheelVelocity, -wheelVelocity, 0.0, 0.0,
+      rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_LEFT_DRIVE]),
+      rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_RIGHT_DRIVE]));
+  }
+
+  void SimRobot::drivePct(double speedPct) {
+    double velocity = speedPct / 100.0 * FREE_SPEED_MM_PER_SEC;
+    world.setDriveVelocity(velocity, velocity);
+  }
+
+  void SimRobot::stopDrive() {
+    world.stopDrive();
+  }
+
+  void SimRobot::setElevatorMM(double heightMM, bool blocking) {
+    world.setElevatorTarget(heightMM);
+    while (blocking && !world.elevatorAtTarget(params.elevatorToleranceMM)) {
+      wait(CONTROL_PERIOD_MS);
+    }
+  }
+
+  void SimRobot::setClawRotations(double rotations, bool blocking) {
+    world.setClawTarget(rotations);
+    while (blocking && !world.clawAtTarget()) {
+      wait(CONTROL_PERIOD_MS);
+    }
+  }
+
+  void SimRobot::wait(double ms) {
+    world.advance(ms);
+  }
+
+  double SimRobot::timeMS() {
+    return world.timeMS();
+  }
+
+  void SimRobot::recordRun(lib::RoutineRun run, double durationMS,
+    bool success) {
+    if (run == lib::RUN_PICKUP) {
+      // The robot can't tell an empty claw from a full one, only the world can
+      runResult.pickedUp = success && world.holdingCup();
+      runResult.pickupMS = durationMS;
+      if (runResult.pickedUp && boxAfterPickup) {
+        addBoxAhead(world, boxTurnDegrees);
+        boxAfterPickup = false;
+      }
+    } else if (run == lib::RUN_PLACE) {
+      runResult.placed = success && world.cupsPlaced() > placedBefore;
+      runResult.placeMS = durationMS;
+      placedBefore = world.cupsPlaced();
+    }
+  }
+
+  void SimRobot::addBoxAfterPickup(double turnDegrees) {
+    boxAfterPickup = true;
+    boxTurnDegrees = turnDegrees;
+  }
+
+  lib::Routines& SimRobot::routines() {
+    return robotRoutines;
+  }
+
+  RunResult& SimRobot::result() {
+    runResult.totalMS = world.timeMS();
+    runResult.wallContacts = world.wallContacts();
+    runResult.cupKnocked = world.cupKnocked();
+    return runResult;
+  }
+
+  double SimRobot::degreesToMM(double motorDegrees) {
+    return motorDegrees / 360.0 / geometry::EXTERNAL_GEAR_RATIO
+      * geometry::WHEEL_CIRCUMFERENCE_MM;
+  }
+
+  double SimRobot::rpmToMMPerSec(double rpm) {
+    return degreesToMM(rpm * 6.0);
+  }
+
+  void SimRobot::setVelocityMMPerSec(double leftVelocity, double rightVelocity,
+    double leftAcceleration, double rightAcceleration,
+    double measuredLeftVelocity, double measuredRightVelocity) {
+    double leftVolts = feedforward.calculate(leftVelocity, leftAcceleration)
+      + params.driveVelocityKP * (leftVelocity - measuredLeftVelocity);
+    double rightVolts = feedforward.calculate(rightVelocity, rightAcceleration)
+      + params.driveVelocityKP * (rightVelocity - measuredRightVelocity);
+    world.setDriveVolts(leftVolts, rightVolts);
+  }
+
+  // Robots never sit exactly where they were set down
+  void placeRobotNear(World& world, double x, double y, double headingDegrees) {
+    std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+    world.placeRobot(x + START_JITTER_MM * jitter(world.random()),
+      y + START_JITTER_MM * jitter(world.random()),
+      headingDegrees + START_JITTER_DEG * jitter(world.random()));
+  }
+
+  // A cup somewhere in the scan arc around the given heading from (x, y),
+  // sometimes with a second one further back
+  void addCupsInScanArc(World& world, double x, double y,
+      double headingDegrees) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double bearing = headingDegrees + (unit(world.random()) * 60.0 - 30.0);
+    double range = SENSOR_FORWARD_MM + 350.0 + unit(world.random()) * 550.0;
+    world.addCup(x + range * std::sin(bearing * M_PI / 180.0),
+      y + range * std::cos(bearing * M_PI / 180.0));
+    if (unit(world.random()) < 0.5) {
+      double otherBearing = bearing + (unit(world.random()) < 0.5 ? -1 : 1)
+        * (15.0 + unit(world.random()) * 20.0);
+      double otherRange = range + 300.0 + unit(world.random()) * 400.0;
+      world.addCup(x + otherRange * std::sin(otherBearing * M_PI / 180.0),
+        y + otherRange * std::cos(otherBearing * M_PI / 180.0));
+    }
+  }
+
+  // The box face goes across wherever the robot will point after turning by
+  // turnDegrees, a little off square
+  void addBoxAhead(World& world, double turnDegrees) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double heading = (world.headingDegrees() + turnDegrees) * M_PI / 180.0;
+    double boxRange = SENSOR_FORWARD_MM + 450.0 + unit(world.random()) * 550.0;
+    double boxX = world.robotX() + boxRange * std::sin(heading);
+    double boxY = world.robotY() + boxRange * std::cos(heading);
+    double face = heading
+      + (unit(world.random()) * 2.0 - 1.0) * BOX_SKEW_DEG * M_PI / 180.0;
+    world.addWall(boxX - BOX_HALF_LENGTH_MM * std::cos(face),
+      boxY + BOX_HALF_LENGTH_MM * std::sin(face),
+      boxX + BOX_HALF_LENGTH_MM * std::cos(face),
+      boxY - BOX_HALF_LENGTH_MM * std::sin(face));
+  }
+
+  RunResult runMainAuto(uint32_t seed, const Params& params) {
+    World world(seed);
+    placeRobotNear(world, 0.0, 0.0, 0.0);
+
+    // After both legs the robot faces 180 at (-4600, 4800), with the boxes
+    // to its left
+    addCupsInScanArc(world, -4600.0, 4800.0, 180.0);
+    SimRobot robot(world, params);
+    robot.addBoxAfterPickup(-90.0);
+    robot.routines().runMainAuto();
+    return robot.result();
+  }
+
+  RunResult runPickupTrial(uint32_t seed, const Params& params) {
+    World world(seed);
+    placeRobotNear(world, 0.0, 0.0, 0.0);
+    addCupsInScanArc(world, 0.0, 0.0, 0.0);
+
+    SimRobot robot(world, params);
+    robot.routines().runPickup(true);
+    return robot.result();
+  }
+
+  RunResult runPlaceTrial(uint32_t seed, const Params& params) {
+    World world(seed);
+    placeRobotNear(world, 0.0, 0.0, 0.0);
+
+    // Load a cup the way a pickup leaves it, then stow
+    double heading = world.headingDegrees() * M_PI / 180.0;
+    double reachMM = SENSOR_FORWARD_MM + params.settings.pickupDistanceMM
+      + CUP_RADIUS_MM;
+    world.addCup(world.robotX() + reachMM * std::sin(heading),
+      world.robotY() + reachMM * std::cos(heading));
+    SimRobot robot(world, params);
+    robot.setClawRotations(params.settings.clawOpenRotations, true);
+    robot.setClawRotations(params.settings.clawClosedRotations, true);
+    robot.setElevatorMM(params.settings.stowElevatorMM, true);
+    robot.result().pickedUp = world.holdingCup();
+
+    addBoxAhead(world, 0.0);
+    double startMS = world.timeMS();
+    robot.routines().runAutoPlace(params.settings.placeCupHeightMM, true);
+    RunResult& result = robot.result();
+    result.totalMS -= startMS;
+    return result;
+  }
+}
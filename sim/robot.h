@@ -0,0 +1,110 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: robot.h
+// Description: The robot's own routines and profiled drive, run against a
+// simulated World. Only the device calls differ, the routines and
+// controllers are the same lib code the robot runs.
+
+#pragma once
+
+#include "world.h"
+#include "lib/feedforward.h"
+#include "lib/motion.h"
+#include "lib/routines.h"
+
+namespace sim {
+  // Everything the tuner may change, each named after its constant in
+  // tuning.h
+  struct Params {
+    double driveDistanceSpeedPct;
+    double elevatorToleranceMM;
+    double driveVelocityKP;
+    lib::DriveGains drive;
+    lib::TurnGains turn;
+    lib::RoutineGains routine;
+    // What calibration would hold on the robot
+    lib::RoutineSettings settings;
+  };
+
+  // Values currently in tuning.h
+  Params defaultParams();
+
+  struct RunResult {
+    bool pickedUp;
+    double pickupMS;
+    bool placed;
+    double placeMS;
+    double totalMS;
+    int wallContacts;
+    bool cupKnocked;
+    // Worst overshoot past the target of any profiled move
+    double driveOvershootMM;
+    double turnOvershootDegrees;
+  };
+
+  // Drive, as it runs once characterized, plus the elevator and claw
+  class SimRobot : public lib::RoutineRobot {
+  public:
+    SimRobot(World& world, const Params& params);
+
+    void driveDistance(double distanceMM, bool blocking) override;
+    void turnToAngle(double angleDegrees) override;
+    void turnToHeading(double headingDegrees) override;
+    void spinInPlace(double degreesPerSec) override;
+    void drivePct(double speedPct) override;
+    void stopDrive() override;
+
+    void setElevatorMM(double heightMM, bool blocking) override;
+    void setClawRotations(double rotations, bool blocking) override;
+
+    void wait(double ms) override;
+    double timeMS() override;
+
+    // Whether a pickup or place worked is down to the world, not what the
+    // routine thinks
+    void recordRun(lib::RoutineRun run, double durationMS,
+      bool success) override;
+
+    // Once a cup is picked up, puts a box ahead of where the robot will face
+    // after turning by turnDegrees. The routines take it on faith that the
+    // boxes are there, so the world makes it so.
+    void addBoxAfterPickup(double turnDegrees);
+
+    lib::Routines& routines();
+    RunResult& result();
+
+  private:
+    const double CONTROL_PERIOD_MS = 10.0;
+    const double MM_PER_DEGREE;
+    const double FREE_SPEED_MM_PER_SEC;
+
+    World& world;
+    Params params;
+    lib::Feedforward feedforward;
+    lib::Routines robotRoutines;
+    RunResult runResult;
+    int placedBefore;
+    bool boxAfterPickup;
+    double boxTurnDegrees;
+
+    double degreesToMM(double motorDegrees);
+    double rpmToMMPerSec(double rpm);
+    void setVelocityMMPerSec(double leftVelocity, double rightVelocity,
+      double leftAcceleration, double rightAcceleration,
+      double measuredLeftVelocity, double measuredRightVelocity);
+  };
+
+  // The main auto from the start tile, with the cup and box placed at random
+  // from seed
+  RunResult runMainAuto(uint32_t seed, const Params& params);
+
+  // runPickup on its own, with a cup somewhere in the scan arc
+  RunResult runPickupTrial(uint32_t seed, const Params& params);
+
+  // runAutoPlace on its own, holding a cup with a box somewhere ahead. Times
+  // count from the start of the place.
+  RunResult runPlaceTrial(uint32_t seed, const Params& params);
+}
@@ -0,0 +1,418 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: tune.cpp
+// Description: Searches the speeds, gains and approach distances in tuning.h
+// for the fastest main auto that doesn't overshoot, hit the box or miss the
+// cup, and writes the result out as a new tuning.h and routine.bin. Every
+// candidate is scored over the same set of randomized worlds, spread across
+// all CPU cores. Nothing is written if the result does worse than the current
+// values on worlds the search never saw, unless --force is given.
+//
+// Usage: tune [--scenarios N] [--iterations N] [--population N]
+//             [--threads N] [--seed N] [--in tuning.h] [--out tuning.h]
+//             [--settings routine.bin] [--settings-out routine.bin]
+//             [--force]
+
+#include "robot.h"
+#include "knobs.h"
+#include "pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using sim::KNOBS;
+using sim::KNOB_COUNT;
+
+// What a run costs on top of its cycle time, in seconds. Large enough that
+// no amount of speed makes up for breaking a constraint.
+const double FAILURE_PENALTY_S = 60.0;
+const double COLLISION_PENALTY_S = 20.0;
+const double MAX_DRIVE_OVERSHOOT_MM = 10.0;
+const double DRIVE_OVERSHOOT_PENALTY_S_PER_MM = 1.0;
+const double MAX_TURN_OVERSHOOT_DEG = 2.0;
+const double TURN_OVERSHOOT_PENALTY_S_PER_DEG = 2.0;
+
+// Levels each grid knob is tried at, as fractions of its range
+const double GRID_LEVELS[] = {1.0 / 6.0, 0.5, 5.0 / 6.0};
+const int GRID_LEVEL_COUNT = 3;
+
+// Cross-entropy search, in knob ranges scaled to [0, 1]
+const double INITIAL_SPREAD = 0.15;
+const double MIN_SPREAD = 0.01;
+const double ELITE_FRACTION = 1.0 / 6.0;
+// How much of the old mean and spread carry over each iteration
+const double SMOOTHING = 0.3;
+
+// Validation worlds are seeded far from the search worlds so the result is
+// checked on layouts the search never saw
+const uint32_t VALIDATION_SEED_OFFSET = 1000000;
+
+// Knob positions scaled to [0, 1] across each knob's range
+typedef std::vector<double> Point;
+
+struct Options {
+  int scenarios = 16;
+  int iterations = 25;
+  int population = 48;
+  int threads = 0;
+  uint32_t seed = 1;
+  std::string in = "../include/tuning.h";
+  std::string out = "build/tuning.h";
+  // The robot's calibrated settings, every candidate runs with them
+  std::string settings;
+  // Those settings with the tuned distances, to copy onto the SD card since
+  // the robot prefers them over tuning.h
+  std::string settingsOut = "build/routine.bin";
+  // Write even if the tuned values did worse on the validation worlds
+  bool force = false;
+};
+
+struct Score {
+  // Mean cost per run in seconds, what the search minimizes
+  double cost;
+  double successRate;
+  double meanCycleS;
+  int collisions;
+  int overshoots;
+};
+
+double roundTo(double value, int decimals) {
+  double scale = std::pow(10.0, decimals);
+  return std::round(value * scale) / scale;
+}
+
+// Values are rounded the same way they will be written out, so the score
+// belongs to the file that gets emitted. Anything not a knob comes from base.
+sim::Params toParams(const Point& point, const sim::Params& base) {
+  sim::Params params = base;
+  for (int k = 0; k < KNOB_COUNT; k++) {
+    double value = KNOBS[k].low + point[k] * (KNOBS[k].high - KNOBS[k].low);
+    KNOBS[k].set(params, roundTo(value, KNOBS[k].decimals));
+  }
+  return params;
+}
+
+Point toPoint(sim::Params params) {
+  Point point(KNOB_COUNT);
+  for (int k = 0; k < KNOB_COUNT; k++) {
+    double value = KNOBS[k].get(params);
+    point[k] = std::fmax(0.0, std::fmin(1.0,
+      (value - KNOBS[k].low) / (KNOBS[k].high - KNOBS[k].low)));
+  }
+  return point;
+}
+
+double runCost(const sim::RunResult& result) {
+  double cost = result.totalMS / 1000.0;
+  if (!result.pickedUp || !result.placed) {
+    cost += FAILURE_PENALTY_S;
+  }
+  cost += COLLISION_PENALTY_S * result.wallContacts;
+  if (result.cupKnocked) {
+    cost += COLLISION_PENALTY_S;
+  }
+  cost += DRIVE_OVERSHOOT_PENALTY_S_PER_MM
+    * std::fmax(0.0, result.driveOvershootMM - MAX_DRIVE_OVERSHOOT_MM);
+  cost += TURN_OVERSHOOT_PENALTY_S_PER_DEG
+    * std::fmax(0.0, result.turnOvershootDegrees - MAX_TURN_OVERSHOOT_DEG);
+  return cost;
+}
+
+// Runs every candidate in every world. Each (candidate, world) pair is its own
+// job so a slow candidate doesn't hold up a core while the others sit idle.
+std::vector<Score> evaluate(const std::vector<sim::Params>& candidates,
+  uint32_t firstSeed, const Options& options) {
+  int runs = candidates.size() * options.scenarios;
+  std::vector<sim::RunResult> results(runs);
+  sim::parallelFor(runs, options.threads, [&](int i) {
+    results[i] = sim::runMainAuto(firstSeed + i % options.scenarios,
+      candidates[i / options.scenarios]);
+  });
+
+  std::vector<Score> scores(candidates.size());
+  for (size_t c = 0; c < candidates.size(); c++) {
+    Score score = Score();
+    int successes = 0;
+    double cycleS = 0.0;
+    for (int s = 0; s < options.scenarios; s++) {
+      const sim::RunResult& result = results[c * options.scenarios + s];
+      score.cost += runCost(result) / options.scenarios;
+      if (result.pickedUp && result.placed) {
+        successes++;
+        cycleS += result.totalMS / 1000.0;
+      }
+      score.collisions += result.wallContacts + (result.cupKnocked ? 1 : 0);
+      if (result.driveOvershootMM > MAX_DRIVE_OVERSHOOT_MM
+          || result.turnOvershootDegrees > MAX_TURN_OVERSHOOT_DEG) {
+        score.overshoots++;
+      }
+    }
+    score.successRate = (double) successes / options.scenarios;
+    score.meanCycleS = successes > 0 ? cycleS / successes : 0.0;
+    scores[c] = score;
+  }
+  return scores;
+}
+
+void printScore(const char* label, const Score& score) {
+  printf("%-10s cost %7.2f s  success %5.1f%%  cycle %6.2f s  "
+    "collisions %d  overshoots %d\n", label, score.cost,
+    score.successRate * 100.0, score.meanCycleS, score.collisions,
+    score.overshoots);
+}
+
+// Every combination of the grid knobs at each level, with the others left
+// where they are
+std::vector<Point> gridPoints(const Point& start) {
+  std::vector<int> gridKnobs;
+  for (int k = 0; k < KNOB_COUNT; k++) {
+    if (KNOBS[k].grid) {
+      gridKnobs.push_back(k);
+    }
+  }
+
+  std::vector<Point> points;
+  int combinations = (int) std::pow(GRID_LEVEL_COUNT, gridKnobs.size());
+  for (int combination = 0; combination < combinations; combination++) {
+    Point point = start;
+    int remainder = combination;
+    for (int k : gridKnobs) {
+      point[k] = GRID_LEVELS[remainder % GRID_LEVEL_COUNT];
+      remainder /= GRID_LEVEL_COUNT;
+    }
+    points.push_back(point);
+  }
+  return points;
+}
+
+// Cross-entropy method: sample around the current mean, refit the mean and
+// spread of each knob to the best few, repeat. A diagonal relative of CMA-ES
+// that needs no matrix math and copes fine with the noisy, kinked cost here.
+Point crossEntropySearch(Point mean, Score& bestScore,
+  const sim::Params& base, const Options& options, std::mt19937& generator) {
+  Point best = mean;
+  Point spread(KNOB_COUNT, INITIAL_SPREAD);
+  int eliteCount = std::max(2, (int) (options.population * ELITE_FRACTION));
+  std::normal_distribution<double> unitNoise(0.0, 1.0);
+
+  for (int iteration = 0; iteration < options.iterations; iteration++) {
+    std::vector<Point> points(options.population);
+    std::vector<sim::Params> candidates;
+    for (Point& point : points) {
+      point.resize(KNOB_COUNT);
+      for (int k = 0; k < KNOB_COUNT; k++) {
+        point[k] = std::fmax(0.0, std::fmin(1.0,
+          mean[k] + spread[k] * unitNoise(generator)));
+      }
+      candidates.push_back(toParams(point, base));
+    }
+    std::vector<Score> scores = evaluate(candidates, options.seed, options);
+
+    std::vector<int> order(points.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return scores[a].cost < scores[b].cost;
+    });
+    if (scores[order[0]].cost < bestScore.cost) {
+      bestScore = scores[order[0]];
+      best = points[order[0]];
+    }
+
+    for (int k = 0; k < KNOB_COUNT; k++) {
+      double eliteMean = 0.0;
+      for (int e = 0; e < eliteCount; e++) {
+        eliteMean += points[order[e]][k] / eliteCount;
+      }
+      double eliteVariance = 0.0;
+      for (int e = 0; e < eliteCount; e++) {
+        double difference = points[order[e]][k] - eliteMean;
+        eliteVariance += difference * difference / eliteCount;
+      }
+      mean[k] = SMOOTHING * mean[k] + (1.0 - SMOOTHING) * eliteMean;
+      spread[k] = std::fmax(MIN_SPREAD, SMOOTHING * spread[k]
+        + (1.0 - SMOOTHING) * std::sqrt(eliteVariance));
+    }
+
+    char label[16];
+    snprintf(label, sizeof(label), "iter %d", iteration + 1);
+    printScore(label, bestScore);
+  }
+  return best;
+}
+
+// Copies tuning.h with the tuned values swapped in, so the comments and every
+// constant the tuner doesn't touch come through unchanged
+bool writeTuning(const sim::Params& params, const Options& options) {
+  std::ifstream in(options.in.c_str());
+  if (!in) {
+    fprintf(stderr, "Can't read %s\n", options.in.c_str());
+    return false;
+  }
+  std::ofstream out(options.out.c_str());
+  if (!out) {
+    fprintf(stderr, "Can't write %s\n", options.out.c_str());
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    for (int k = 0; k < KNOB_COUNT; k++) {
+      std::string declaration = std::string("const double ") + KNOBS[k].name
+        + " = ";
+      size_t start = line.find(declaration);
+      if (start == std::string::npos) {
+        continue;
+      }
+      // Untouched values keep their formatting so the diff shows only changes
+      double current = atof(line.c_str() + start + declaration.size());
+      if (roundTo(current, KNOBS[k].decimals) == KNOBS[k].get(params)) {
+        break;
+      }
+      char value[32];
+      snprintf(value, sizeof(value), "%.*f", KNOBS[k].decimals,
+        KNOBS[k].get(params));
+      line = line.substr(0, start + declaration.size()) + value + ";";
+      break;
+    }
+    out << line << "\n";
+  }
+  return true;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--force") == 0) {
+      options.force = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (strcmp(argv[i - 1], "--scenarios") == 0) {
+      options.scenarios = std::max(1, atoi(value));
+    } else if (strcmp(argv[i - 1], "--iterations") == 0) {
+      options.iterations = std::max(0, atoi(value));
+    } else if (strcmp(argv[i - 1], "--population") == 0) {
+      options.population = std::max(4, atoi(value));
+    } else if (strcmp(argv[i - 1], "--threads") == 0) {
+      options.threads = atoi(value);
+    } else if (strcmp(argv[i - 1], "--seed") == 0) {
+      options.seed = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i - 1], "--in") == 0) {
+      options.in = value;
+    } else if (strcmp(argv[i - 1], "--out") == 0) {
+      options.out = value;
+    } else if (strcmp(argv[i - 1], "--settings") == 0) {
+      options.settings = value;
+    } else if (strcmp(argv[i - 1], "--settings-out") == 0) {
+      options.settingsOut = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "Usage: %s [--scenarios N] [--iterations N] "
+      "[--population N] [--threads N] [--seed N] [--in tuning.h] "
+      "[--out tuning.h] [--settings routine.bin] "
+      "[--settings-out routine.bin] [--force]\n", argv[0]);
+    return 2;
+  }
+  std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+  printf("%d worlds per candidate on %d threads\n", options.scenarios,
+    sim::threadCount(options.threads));
+
+  // Start from the file being tuned, which may differ from the tuning.h this
+  // was built with
+  sim::Params baseline = sim::defaultParams();
+  if (!sim::readTuning(options.in, baseline)) {
+    fprintf(stderr, "Can't read %s\n", options.in.c_str());
+    return 1;
+  }
+  if (!options.settings.empty()
+      && !sim::readSettings(options.settings, baseline.settings)) {
+    fprintf(stderr, "Can't read %s\n", options.settings.c_str());
+    return 1;
+  }
+  Score baselineScore =
+    evaluate(std::vector<sim::Params>(1, baseline), options.seed, options)[0];
+  printScore("current", baselineScore);
+
+  // Stage one: coarse grid over the speed limits, everything else as is
+  std::vector<Point> grid = gridPoints(toPoint(baseline));
+  std::vector<sim::Params> gridCandidates;
+  for (const Point& point : grid) {
+    gridCandidates.push_back(toParams(point, baseline));
+  }
+  std::vector<Score> gridScores = evaluate(gridCandidates, options.seed, options);
+  Point best = toPoint(baseline);
+  Score bestScore = baselineScore;
+  for (size_t i = 0; i < grid.size(); i++) {
+    if (gridScores[i].cost < bestScore.cost) {
+      bestScore = gridScores[i];
+      best = grid[i];
+    }
+  }
+  printf("%zu grid points\n", grid.size());
+  printScore("grid", bestScore);
+
+  // Stage two: every knob at once, starting from the best grid point
+  std::mt19937 generator(options.seed);
+  best = crossEntropySearch(best, bestScore, baseline, options, generator);
+  sim::Params tuned = toParams(best, baseline);
+
+  std::vector<sim::Params> finalists;
+  finalists.push_back(baseline);
+  finalists.push_back(tuned);
+  std::vector<Score> validation = evaluate(finalists,
+    options.seed + VALIDATION_SEED_OFFSET, options);
+  printf("On %d unseen worlds:\n", options.scenarios);
+  printScore("current", validation[0]);
+  printScore("tuned", validation[1]);
+  bool regressed = validation[1].cost >= validation[0].cost;
+
+  printf("\n");
+  for (int k = 0; k < KNOB_COUNT; k++) {
+    printf("%-36s %12.*f -> %.*f\n", KNOBS[k].name, KNOBS[k].decimals,
+      KNOBS[k].get(baseline), KNOBS[k].decimals, KNOBS[k].get(tuned));
+  }
+
+  double seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - startTime).count();
+  // The search worlds reward whatever fits them, only the unseen ones say
+  // whether the tuned values are actually better
+  if (regressed && !options.force) {
+    fprintf(stderr, "\nTuned values did no better on unseen worlds, wrote "
+      "nothing after %.0f s. Try more --scenarios, or --force.\n", seconds);
+    return 1;
+  }
+  if (!writeTuning(tuned, options)) {
+    return 1;
+  }
+  if (!sim::writeSettings(options.settingsOut, tuned.settings)) {
+    fprintf(stderr, "Can't write %s\n", options.settingsOut.c_str());
+    return 1;
+  }
+
+  printf("\nWrote %s and %s in %.0f s\n", options.out.c_str(),
+    options.settingsOut.c_str(), seconds);
+  return 0;
+}
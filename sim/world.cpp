@@ -0,0 +1,506 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: world.cpp
+// Description: Simulated robot and field for the host tools. Hands the
+// routines the same SensorFrame the robot reads, so the control code sees no
+// difference.
+
+#include "world.h"
+#include "geometry.h"
+#include <cmath>
+
+namespace sim {
+  const double STEP_MS = 1.0;
+  const double MAX_VOLTS = 12.0;
+  const double DEG_PER_RAD = 180.0 / M_PI;
+
+  // V5 motor's internal velocity loop, volts per mm/s of error
+  const double MOTOR_VELOCITY_KP = 0.02;
+  // How hard driveFor() slows down toward its distance
+  const double DRIVE_FOR_DECELERATION_MM_PER_SEC2 = 800.0;
+  const double DRIVE_FOR_TOLERANCE_MM = 2.0;
+
+  // spinToPosition() at the default 50% of a green cartridge
+  const double ELEVATOR_SPEED_MM_PER_SEC = 257.0;
+  // The motor eases into its setpoint, closing the last stretch about this
+  // fast, and calls it there once within a fraction of a mm
+  const double ELEVATOR_SETTLE_SECONDS = 0.08;
+  const double ELEVATOR_DONE_MM = 0.1;
+  const double ELEVATOR_MM_PER_DEGREE = 154.2 / 360.0;
+  const double CLAW_SPEED_ROTATIONS_PER_SEC = 1.67;
+
+  // Claw arms meet around a cup below this position, and let go above it
+  const double CLAW_GRIP_ROTATIONS = 0.5;
+  // Where a cup's near edge has to be, ahead of the sensor, for the claw to
+  // close around it
+  const double CAPTURE_MIN_MM = 40.0;
+  const double CAPTURE_MAX_MM = 115.0;
+  const double CAPTURE_HALF_WIDTH_MM = 35.0;
+  // The open claw pushes a cup along once it gets this close to the sensor
+  const double CLAW_HALF_WIDTH_MM = 70.0;
+  const double KNOCK_MM = 30.0;
+  // A held cup sits about where it was picked up, its center roughly 117 mm
+  // ahead of the sensor. Let go further than this from the box face and less
+  // than half of it is over the box.
+  const double PLACE_WINDOW_MM = 77.0;
+  // Placing ends with the robot nearly touching the box, so a gentle touch
+  // is fine. Anything faster than this shoves the boxes.
+  const double WALL_HIT_MM_PER_SEC = 100.0;
+
+  const double SENSOR_MAX_RANGE_MM = 2000.0;
+  const double SENSOR_NO_RETURN_MM = 9999.0;
+  const double SENSOR_BEAM_HALF_DEG = 4.0;
+
+  World::World(uint32_t seed)
+  : generator(seed),
+    unitNoise(0.0, 1.0),
+    time(0.0),
+    x(0.0),
+    y(0.0),
+    heading(0.0),
+    headingRate(0.0),
+    driveMode(DRIVE_BRAKE),
+    driveForStartTravel(0.0),
+    driveForDistance(0.0),
+    driveForSpeed(0.0),
+    elevatorHeight(0.0),
+    elevatorTarget(0.0),
+    claw(0.0),
+    clawTarget(0.0),
+    heldCup(-1),
+    placed(0),
+    dropped(0),
+    contacts(0),
+    knocked(false) {
+    // Each side differs a little from what characterization measured
+    Side* sides[2] = {&left, &right};
+    for (Side* side : sides) {
+      side->kS = NOMINAL_KS * uniform(0.9, 1.1);
+      side->kV = NOMINAL_KV * uniform(0.95, 1.05);
+      side->kA = NOMINAL_KA * uniform(0.9, 1.1);
+      side->velocity = 0.0;
+      side->travel = 0.0;
+      side->volts = 0.0;
+      side->targetVelocity = 0.0;
+    }
+    turnScrub = uniform(1.0, 1.08);
+
+    imuDriftDegPerSec = uniform(-0.02, 0.02);
+    imuScale = uniform(-0.005, 0.005);
+    sensorLatencyMS = uniform(30.0, 50.0);
+  }
+
+  lib::SensorFrame World::read() {
+    lib::SensorFrame frame = lib::SensorFrame();
+    frame.timestampMS = (uint32_t) time;
+
+    double degreesPerMM = 360.0 * geometry::EXTERNAL_GEAR_RATIO
+      / geometry::WHEEL_CIRCUMFERENCE_MM;
+    frame.leftPositionDegrees = left.travel * degreesPerMM;
+    frame.rightPositionDegrees = right.travel * degreesPerMM;
+    frame.elevatorPositionDegrees = elevatorHeight / ELEVATOR_MM_PER_DEGREE;
+    frame.intakePositionDegrees = claw * 360.0;
+
+    double rotation = heading * (1.0 + imuScale)
+      + imuDriftDegPerSec * time / 1000.0 + noise(0.05);
+    frame.rotationDegrees = rotation;
+    frame.headingDegrees = std::fmod(std::fmod(rotation, 360.0) + 360.0, 360.0);
+    frame.gyroRateDegPerSec = headingRate * (1.0 + imuScale) + noise(0.3);
+    frame.distanceMM = distanceHistory.empty()
+      ? SENSOR_NO_RETURN_MM : distanceHistory.front();
+    frame.batteryVolts = 12.6;
+
+    frame.motorVelocityRPM[lib::MOTOR_LEFT_DRIVE] = left.velocity * degreesPerMM / 6.0;
+    frame.motorVelocityRPM[lib::MOTOR_RIGHT_DRIVE] = right.velocity * degreesPerMM / 6.0;
+    for (int i = 0; i < lib::FRAME_MOTOR_COUNT; i++) {
+      frame.motorTemperatureC[i] = 25.0;
+    }
+
+    if (elevatorHeight <= 0.5) {
+      frame.limitSwitches |= lib::LIMIT_LOWER;
+    }
+    frame.controlMode = lib::CONTROL_NONE;
+    return frame;
+  }
+
+  void World::record(const lib::SensorFrame&) {}
+
+  void World::advance(double ms) {
+    for (double elapsed = 0.0; elapsed < ms; elapsed += STEP_MS) {
+      step(STEP_MS / 1000.0);
+    }
+  }
+
+  double World::timeMS() {
+    return time;
+  }
+
+  std::mt19937& World::random() {
+    return generator;
+  }
+
+  void World::placeRobot(double newX, double newY, double headingDegrees) {
+    x = newX;
+    y = newY;
+    heading = headingDegrees;
+  }
+
+  void World::addCup(double cupX, double cupY) {
+    cups.push_back({cupX, cupY, CUP_RADIUS_MM});
+  }
+
+  void World::addWall(double x1, double y1, double x2, double y2) {
+    walls.push_back({x1, y1, x2, y2});
+  }
+
+  void World::setDriveVolts(double leftVolts, double rightVolts) {
+    driveMode = DRIVE_VOLTAGE;
+    left.volts = std::fmax(-MAX_VOLTS, std::fmin(MAX_VOLTS, leftVolts));
+    right.volts = std::fmax(-MAX_VOLTS, std::fmin(MAX_VOLTS, rightVolts));
+  }
+
+  void World::setDriveVelocity(double leftMMPerSec, double rightMMPerSec) {
+    driveMode = DRIVE_VELOCITY;
+    left.targetVelocity = leftMMPerSec;
+    right.targetVelocity = rightMMPerSec;
+  }
+
+  void World::driveFor(double distanceMM, double speedMMPerSec) {
+    driveMode = DRIVE_FOR;
+    driveForStartTravel = (left.travel + right.travel) / 2.0;
+    driveForDistance = distanceMM;
+    driveForSpeed = speedMMPerSec;
+  }
+
+  bool World::driveForDone() {
+    return driveMode != DRIVE_FOR;
+  }
+
+  void World::stopDrive() {
+    driveMode = DRIVE_BRAKE;
+  }
+
+  void World::setElevatorTarget(double heightMM) {
+    elevatorTarget = heightMM;
+  }
+
+  bool World::elevatorAtTarget(double toleranceMM) {
+    return std::fabs(elevatorHeight - elevatorTarget)
+      < std::fmax(toleranceMM, ELEVATOR_DONE_MM);
+  }
+
+  void World::setClawTarget(double rotations) {
+    clawTarget = rotations;
+  }
+
+  bool World::clawAtTarget() {
+    return claw == clawTarget;
+  }
+
+  double World::robotX() {
+    return x;
+  }
+
+  double World::robotY() {
+    return y;
+  }
+
+  double World::headingDegrees() {
+    return heading;
+  }
+
+  double World::wallClearanceMM() {
+    double sensorX = x + SENSOR_FORWARD_MM * std::sin(heading / DEG_PER_RAD);
+    double sensorY = y + SENSOR_FORWARD_MM * std::cos(heading / DEG_PER_RAD);
+    double nearest = INFINITY;
+    for (const Segment& wall : walls) {
+      double dx = wall.x2 - wall.x1;
+      double dy = wall.y2 - wall.y1;
+      double lengthSquared = dx * dx + dy * dy;
+      double along = ((sensorX - wall.x1) * dx + (sensorY - wall.y1) * dy)
+        / lengthSquared;
+      along = std::fmax(0.0, std::fmin(1.0, along));
+      nearest = std::fmin(nearest, std::hypot(
+        sensorX - (wall.x1 + along * dx), sensorY - (wall.y1 + along * dy)));
+    }
+    return nearest;
+  }
+
+  bool World::holdingCup() {
+    return heldCup >= 0;
+  }
+
+  int World::cupsPlaced() {
+    return placed;
+  }
+
+  int World::cupsDropped() {
+    return dropped;
+  }
+
+  int World::wallContacts() {
+    return contacts;
+  }
+
+  bool World::cupKnocked() {
+    return knocked;
+  }
+
+  void World::step(double dt) {
+    double lastX = x;
+    double lastY = y;
+    double lastHeading = heading;
+    double lastLeftTravel = left.travel;
+    double lastRightTravel = right.travel;
+
+    updateDrive();
+    stepSide(left, dt);
+    stepSide(right, dt);
+
+    double velocity = (left.velocity + right.velocity) / 2.0;
+    headingRate = (left.velocity - right.velocity)
+      / (geometry::TRACK_WIDTH_MM * turnScrub) * DEG_PER_RAD;
+    heading += headingRate * dt;
+    x += velocity * std::sin(heading / DEG_PER_RAD) * dt;
+    y += velocity * std::cos(heading / DEG_PER_RAD) * dt;
+
+    // Walls don't give, a robot driving into one stops dead
+    if (crossesWall(lastX, lastY, lastHeading)) {
+      if (std::fabs(velocity) > WALL_HIT_MM_PER_SEC) {
+        contacts++;
+      }
+      x = lastX;
+      y = lastY;
+      heading = lastHeading;
+      headingRate = 0.0;
+      left.travel = lastLeftTravel;
+      right.travel = lastRightTravel;
+      left.velocity = 0.0;
+      right.velocity = 0.0;
+    }
+
+    double elevatorError = elevatorTarget - elevatorHeight;
+    double elevatorStep = std::fmin(ELEVATOR_SPEED_MM_PER_SEC,
+      std::fabs(elevatorError) / ELEVATOR_SETTLE_SECONDS) * dt;
+    if (std::fabs(elevatorError) < ELEVATOR_DONE_MM) {
+      elevatorHeight = elevatorTarget;
+    } else {
+      elevatorHeight += elevatorError > 0.0 ? elevatorStep : -elevatorStep;
+    }
+    double lastClaw = claw;
+    double clawStep = CLAW_SPEED_ROTATIONS_PER_SEC * dt;
+    claw += std::fmax(-clawStep, std::fmin(clawStep, clawTarget - claw));
+    updateClaw(lastClaw);
+
+    pushCups();
+
+    distanceHistory.push_back(castDistance());
+    while (distanceHistory.size() > sensorLatencyMS / STEP_MS) {
+      distanceHistory.pop_front();
+    }
+    time += dt * 1000.0;
+  }
+
+  void World::stepSide(Side& side, double dt) {
+    double friction = side.kS * (side.velocity > 0.0 ? 1.0 : -1.0);
+    if (std::fabs(side.velocity) < 1.0) {
+      // Static friction holds until the motor pushes past it
+      if (std::fabs(side.volts) <= side.kS) {
+        side.velocity = 0.0;
+        return;
+      }
+      friction = side.kS * (side.volts > 0.0 ? 1.0 : -1.0);
+    }
+
+    double acceleration =
+      (side.volts - friction - side.kV * side.velocity) / side.kA;
+    double velocity = side.velocity + acceleration * dt;
+    // Friction stops a coasting wheel, it never turns it around
+    if (velocity * side.velocity < 0.0 && std::fabs(side.volts) <= side.kS) {
+      velocity = 0.0;
+    }
+    side.velocity = velocity;
+    side.travel += velocity * dt;
+  }
+
+  bool World::crossesWall(double lastX, double lastY, double lastHeading) {
+    double fromX = lastX + SENSOR_FORWARD_MM * std::sin(lastHeading / DEG_PER_RAD);
+    double fromY = lastY + SENSOR_FORWARD_MM * std::cos(lastHeading / DEG_PER_RAD);
+    double toX = x + SENSOR_FORWARD_MM * std::sin(heading / DEG_PER_RAD);
+    double toY = y + SENSOR_FORWARD_MM * std::cos(heading / DEG_PER_RAD);
+
+    for (const Segment& wall : walls) {
+      double wallX = wall.x2 - wall.x1;
+      double wallY = wall.y2 - wall.y1;
+      double fromSide = wallX * (fromY - wall.y1) - wallY * (fromX - wall.x1);
+      double toSide = wallX * (toY - wall.y1) - wallY * (toX - wall.x1);
+      if (fromSide * toSide > 0.0 || fromSide == toSide) {
+        continue;
+      }
+      double crossing = fromSide / (fromSide - toSide);
+      double crossX = fromX + crossing * (toX - fromX);
+      double crossY = fromY + crossing * (toY - fromY);
+      double along = ((crossX - wall.x1) * wallX + (crossY - wall.y1) * wallY)
+        / (wallX * wallX + wallY * wallY);
+      if (along >= 0.0 && along <= 1.0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void World::updateDrive() {
+    if (driveMode == DRIVE_VOLTAGE) {
+      return;
+    }
+
+    if (driveMode == DRIVE_FOR) {
+      double remaining = driveForDistance
+        - ((left.travel + right.travel) / 2.0 - driveForStartTravel);
+      if (std::fabs(remaining) < DRIVE_FOR_TOLERANCE_MM) {
+        driveMode = DRIVE_BRAKE;
+      } else {
+        double speed = std::fmin(driveForSpeed,
+          std::sqrt(2.0 * DRIVE_FOR_DECELERATION_MM_PER_SEC2 * std::fabs(remaining)));
+        left.targetVelocity = remaining > 0.0 ? speed : -speed;
+        right.targetVelocity = left.targetVelocity;
+      }
+    }
+    if (driveMode == DRIVE_BRAKE) {
+      left.targetVelocity = 0.0;
+      right.targetVelocity = 0.0;
+    }
+
+    Side* sides[2] = {&left, &right};
+    for (Side* side : sides) {
+      double target = side->targetVelocity;
+      double volts = NOMINAL_KV * target
+        + MOTOR_VELOCITY_KP * (target - side->velocity);
+      if (target != 0.0) {
+        volts += target > 0.0 ? NOMINAL_KS : -NOMINAL_KS;
+      }
+      side->volts = std::fmax(-MAX_VOLTS, std::fmin(MAX_VOLTS, volts));
+    }
+  }
+
+  void World::updateClaw(double lastClaw) {
+    double sensorX = x + SENSOR_FORWARD_MM * std::sin(heading / DEG_PER_RAD);
+    double sensorY = y + SENSOR_FORWARD_MM * std::cos(heading / DEG_PER_RAD);
+
+    if (lastClaw > CLAW_GRIP_ROTATIONS && claw <= CLAW_GRIP_ROTATIONS
+        && heldCup < 0) {
+      for (size_t i = 0; i < cups.size(); i++) {
+        double dx = cups[i].x - sensorX;
+        double dy = cups[i].y - sensorY;
+        double ahead = dx * std::sin(heading / DEG_PER_RAD)
+          + dy * std::cos(heading / DEG_PER_RAD) - cups[i].radiusMM;
+        double across = dx * std::cos(heading / DEG_PER_RAD)
+          - dy * std::sin(heading / DEG_PER_RAD);
+        if (ahead >= CAPTURE_MIN_MM && ahead <= CAPTURE_MAX_MM
+            && std::fabs(across) <= CAPTURE_HALF_WIDTH_MM) {
+          heldCup = i;
+          break;
+        }
+      }
+    }
+
+    if (lastClaw < CLAW_GRIP_ROTATIONS && claw >= CLAW_GRIP_ROTATIONS
+        && heldCup >= 0) {
+      if (wallClearanceMM() <= PLACE_WINDOW_MM) {
+        placed++;
+      } else {
+        dropped++;
+      }
+      cups.erase(cups.begin() + heldCup);
+      heldCup = -1;
+    }
+  }
+
+  void World::pushCups() {
+    double sensorX = x + SENSOR_FORWARD_MM * std::sin(heading / DEG_PER_RAD);
+    double sensorY = y + SENSOR_FORWARD_MM * std::cos(heading / DEG_PER_RAD);
+    for (size_t i = 0; i < cups.size(); i++) {
+      if ((int) i == heldCup) {
+        continue;
+      }
+      double dx = cups[i].x - sensorX;
+      double dy = cups[i].y - sensorY;
+      double ahead = dx * std::sin(heading / DEG_PER_RAD)
+        + dy * std::cos(heading / DEG_PER_RAD) - cups[i].radiusMM;
+      double across = dx * std::cos(heading / DEG_PER_RAD)
+        - dy * std::sin(heading / DEG_PER_RAD);
+      if (std::fabs(across) < CLAW_HALF_WIDTH_MM
+          && ahead > -cups[i].radiusMM && ahead < KNOCK_MM) {
+        knocked = true;
+        double push = KNOCK_MM - ahead;
+        cups[i].x += push * std::sin(heading / DEG_PER_RAD);
+        cups[i].y += push * std::cos(heading / DEG_PER_RAD);
+      }
+    }
+  }
+
+  // The sensor sees a cone, so the nearest of a few rays across it counts
+  double World::castDistance() {
+    double sensorX = x + SENSOR_FORWARD_MM * std::sin(heading / DEG_PER_RAD);
+    double sensorY = y + SENSOR_FORWARD_MM * std::cos(heading / DEG_PER_RAD);
+    double nearest = std::fmin(castRay(sensorX, sensorY, heading), std::fmin(
+      castRay(sensorX, sensorY, heading - SENSOR_BEAM_HALF_DEG),
+      castRay(sensorX, sensorY, heading + SENSOR_BEAM_HALF_DEG)));
+    if (nearest > SENSOR_MAX_RANGE_MM) {
+      return SENSOR_NO_RETURN_MM;
+    }
+    return std::fmax(0.0, nearest + noise(1.0 + 0.01 * nearest));
+  }
+
+  double World::castRay(double originX, double originY, double degrees) {
+    double directionX = std::sin(degrees / DEG_PER_RAD);
+    double directionY = std::cos(degrees / DEG_PER_RAD);
+    double nearest = INFINITY;
+
+    for (size_t i = 0; i < cups.size(); i++) {
+      if ((int) i == heldCup) {
+        continue;
+      }
+      double fx = originX - cups[i].x;
+      double fy = originY - cups[i].y;
+      double b = fx * directionX + fy * directionY;
+      double c = fx * fx + fy * fy - cups[i].radiusMM * cups[i].radiusMM;
+      double discriminant = b * b - c;
+      if (discriminant < 0.0) {
+        continue;
+      }
+      double hit = -b - std::sqrt(discriminant);
+      if (hit >= 0.0) {
+        nearest = std::fmin(nearest, hit);
+      }
+    }
+
+    for (const Segment& wall : walls) {
+      double wallX = wall.x2 - wall.x1;
+      double wallY = wall.y2 - wall.y1;
+      double denominator = directionX * wallY - directionY * wallX;
+      if (std::fabs(denominator) < 1e-9) {
+        continue;
+      }
+      double toWallX = wall.x1 - originX;
+      double toWallY = wall.y1 - originY;
+      double hit = (toWallX * wallY - toWallY * wallX) / denominator;
+      double along = (toWallX * directionY - toWallY * directionX) / denominator;
+      if (hit >= 0.0 && along >= 0.0 && along <= 1.0) {
+        nearest = std::fmin(nearest, hit);
+      }
+    }
+    return nearest;
+  }
+
+  double World::noise(double standardDeviation) {
+    return unitNoise(generator) * standardDeviation;
+  }
+
+  double World::uniform(double low, double high) {
+    return std::uniform_real_distribution<double>(low, high)(generator);
+  }
+}
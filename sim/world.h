@@ -0,0 +1,158 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: world.h
+// Description: Simulated robot and field for the host tools. Hands the
+// routines the same SensorFrame the robot reads, so the control code sees no
+// difference.
+
+#pragma once
+
+#include "lib/frame.h"
+#include <deque>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+namespace sim {
+  // What characterization measures on the real drive, per side. Swap in the
+  // numbers from drive_gains.bin once the robot has been characterized.
+  const double NOMINAL_KS = 0.6;
+  const double NOMINAL_KV = 0.0107;
+  const double NOMINAL_KA = 0.003;
+
+  // Distance sensor position ahead of the drive's center
+  const double SENSOR_FORWARD_MM = 160.0;
+  const double CUP_RADIUS_MM = 40.0;
+
+  struct Circle {
+    double x;
+    double y;
+    double radiusMM;
+  };
+
+  struct Segment {
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+  };
+
+  // Field is in mm, headings in degrees clockwise from +y, the same way the
+  // inertial sensor counts
+  class World : public lib::SensorSource {
+  public:
+    // Every random choice (plant spread, sensor noise) comes from seed, so a
+    // world can be rebuilt exactly
+    explicit World(uint32_t seed);
+
+    lib::SensorFrame read();
+    // Nothing to log in simulation
+    void record(const lib::SensorFrame& frame);
+
+    void advance(double ms);
+    double timeMS();
+    std::mt19937& random();
+
+    void placeRobot(double x, double y, double headingDegrees);
+    void addCup(double x, double y);
+    void addWall(double x1, double y1, double x2, double y2);
+
+    // Voltage mode, how the profiled drive and turn reach the motors
+    void setDriveVolts(double leftVolts, double rightVolts);
+    // The motors' own velocity loop, what smartdrive uses
+    void setDriveVelocity(double leftMMPerSec, double rightMMPerSec);
+    // smartdrive.driveFor(): runs on its own until the distance is covered
+    void driveFor(double distanceMM, double speedMMPerSec);
+    bool driveForDone();
+    void stopDrive();
+
+    void setElevatorTarget(double heightMM);
+    // Like Elevator::atTarget(), which ends a blocking move
+    bool elevatorAtTarget(double toleranceMM);
+    void setClawTarget(double rotations);
+    bool clawAtTarget();
+
+    double robotX();
+    double robotY();
+    double headingDegrees();
+    // Free space between the distance sensor and the nearest wall
+    double wallClearanceMM();
+
+    // Scoring, filled in as the world runs
+    bool holdingCup();
+    int cupsPlaced();
+    int cupsDropped();
+    // Times the robot ran into a wall rather than easing up to it
+    int wallContacts();
+    bool cupKnocked();
+
+  private:
+    struct Side {
+      double kS;
+      double kV;
+      double kA;
+      double velocity;
+      double travel;
+      double volts;
+      double targetVelocity;
+    };
+
+    enum DriveMode {
+      DRIVE_VOLTAGE,
+      DRIVE_VELOCITY,
+      DRIVE_FOR,
+      DRIVE_BRAKE
+    };
+
+    std::mt19937 generator;
+    std::normal_distribution<double> unitNoise;
+
+    double time;
+    double x;
+    double y;
+    double heading;
+    double headingRate;
+    Side left;
+    Side right;
+    DriveMode driveMode;
+    double driveForStartTravel;
+    double driveForDistance;
+    double driveForSpeed;
+    // Wheels slide sideways a little when turning, so the robot turns less
+    // than the wheel travel says
+    double turnScrub;
+
+    double imuDriftDegPerSec;
+    double imuScale;
+    double sensorLatencyMS;
+    std::deque<double> distanceHistory;
+
+    double elevatorHeight;
+    double elevatorTarget;
+    double claw;
+    double clawTarget;
+
+    std::vector<Circle> cups;
+    std::vector<Segment> walls;
+    int heldCup;
+    int placed;
+    int dropped;
+    int contacts;
+    bool knocked;
+
+    void step(double dt);
+    void stepSide(Side& side, double dt);
+    // Whether the sensor passed through a wall since the given pose
+    bool crossesWall(double lastX, double lastY, double lastHeading);
+    void updateDrive();
+    void updateClaw(double lastClaw);
+    void pushCups();
+    double castDistance();
+    double castRay(double originX, double originY, double degrees);
+    double noise(double standardDeviation);
+    double uniform(double low, double high);
+  };
+}
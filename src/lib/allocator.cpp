@@ -0,0 +1,131 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: allocator.cpp
+// Description: Decides how much of a shared current budget each motor gets
+// from its latest readings. Kept apart from the motors themselves so a
+// recorded run can be fed back through it.
+
+#include "lib/allocator.h"
+#include <cmath>
+
+namespace lib {
+  CurrentAllocator::CurrentAllocator(double totalCurrentAmps)
+  : TOTAL_CURRENT_AMPS(totalCurrentAmps) {}
+
+  int CurrentAllocator::addMotor(double priority, double holdCurrentAmps) {
+    Motor motor;
+    motor.priority = priority;
+    motor.holdCurrentAmps = holdCurrentAmps;
+    motor.holdLimitAmps = holdCurrentAmps;
+    motor.headroom = 1.0;
+    motor.limitAmps = MAX_MOTOR_CURRENT_AMPS;
+    motor.speedScale = 1.0;
+    motor.saturatedSinceMS = -1;
+    motor.restingSinceMS = -1;
+
+    motors.push_back(motor);
+    return motors.size() - 1;
+  }
+
+  void CurrentAllocator::allocate(const std::vector<MotorSample>& samples,
+    int32_t nowMS) {
+    double remainingAmps = TOTAL_CURRENT_AMPS;
+    double totalWeight = 0.0;
+    std::vector<bool> moving(motors.size());
+
+    for (size_t i = 0; i < motors.size() && i < samples.size(); i++) {
+      Motor& motor = motors[i];
+      const MotorSample& sample = samples[i];
+
+      motor.headroom = (DERATE_TEMPERATURE_C - sample.temperatureC) 
+        / (DERATE_TEMPERATURE_C - AMBIENT_TEMPERATURE_C);
+      motor.headroom = std::fmax(0.0, std::fmin(1.0, motor.headroom));
+
+      motor.speedScale = MIN_SPEED_SCALE + (1.0 - MIN_SPEED_SCALE) 
+        * std::fmin(1.0, motor.headroom / SPEED_SCALE_KNEE);
+
+      // A motor pinned at its limit from a standstill gets a short window
+      // of full share to start moving. If it still hasn't moved by then it
+      // is stalled against something, like the claw gripping a cup, and
+      // goes back to its hold current until the load lets go of it.
+      bool saturated = sample.currentAmps >= SATURATED_FRACTION * motor.limitAmps;
+      if (!saturated) {
+        motor.saturatedSinceMS = -1;
+      } else if (motor.saturatedSinceMS < 0) {
+        motor.saturatedSinceMS = nowMS;
+      }
+      bool starting = saturated 
+        && nowMS - motor.saturatedSinceMS < START_WINDOW_MS;
+
+      bool turning = std::fabs(sample.velocityRPM) >= MOVING_RPM;
+      if (turning) {
+        motor.restingSinceMS = -1;
+      } else if (motor.restingSinceMS < 0) {
+        motor.restingSinceMS = nowMS;
+      }
+      bool settling = !turning 
+        && nowMS - motor.restingSinceMS < SETTLE_WINDOW_MS;
+
+      // Standing still with more than its hold current to draw on and not
+      // using all of it, the motor is drawing what its load takes to hold.
+      // Holding at less than that would let the load sag, start the motor
+      // moving again and cycle it between its share and its hold current.
+      if (!turning && !settling && !saturated 
+          && motor.limitAmps > motor.holdLimitAmps) {
+        motor.holdLimitAmps = std::fmin(MAX_MOTOR_CURRENT_AMPS, std::fmax(
+          motor.holdCurrentAmps, sample.currentAmps * HOLD_MARGIN));
+      }
+
+      moving[i] = turning || settling || starting;
+      if (moving[i]) {
+        // Hot motors get a smaller share so they cool off instead of
+        // running into the firmware's limit
+        totalWeight += motor.priority * std::fmax(motor.headroom, 0.1);
+      } else {
+        motor.limitAmps = motor.holdLimitAmps;
+        remainingAmps -= motor.holdLimitAmps;
+      }
+    }
+
+    remainingAmps = std::fmax(0.0, remainingAmps);
+    for (size_t i = 0; i < motors.size() && i < samples.size(); i++) {
+      Motor& motor = motors[i];
+      if (moving[i]) {
+        double weight = motor.priority * std::fmax(motor.headroom, 0.1);
+        motor.limitAmps = std::fmin(MAX_MOTOR_CURRENT_AMPS, 
+          remainingAmps * weight / totalWeight);
+      }
+    }
+  }
+
+  double CurrentAllocator::getLimitAmps(int index) {
+    if (index < 0 || index >= (int) motors.size()) {
+      return MAX_MOTOR_CURRENT_AMPS;
+    }
+    return motors[index].limitAmps;
+  }
+
+  double CurrentAllocator::getHoldAmps(int index) {
+    if (index < 0 || index >= (int) motors.size()) {
+      return 0.0;
+    }
+    return motors[index].holdLimitAmps;
+  }
+
+  double CurrentAllocator::getHeadroom(int index) {
+    if (index < 0 || index >= (int) motors.size()) {
+      return 1.0;
+    }
+    return motors[index].headroom;
+  }
+
+  double CurrentAllocator::getSpeedScale(int index) {
+    if (index < 0 || index >= (int) motors.size()) {
+      return 1.0;
+    }
+    return motors[index].speedScale;
+  }
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: budget.cpp
+// Description: Shares a current budget between motors based on what they are
+// doing and how much thermal headroom they have left, so the firmware never
+// has to derate them on its own.
+
+#include "lib/budget.h"
+#include "lib/telemetry.h"
+
+namespace lib {
+  MotorBudget::MotorBudget(const std::string& name, double totalCurrentAmps)
+  : NAME(name),
+    allocator(totalCurrentAmps) {}
+
+  int MotorBudget::addMotor(const std::string& name, vex::motor& motor,
+    double priority, double holdCurrentAmps) {
+    Entry entry;
+    entry.motor = &motor;
+    entry.powerWatts = 0.0;
+
+    std::string prefix = NAME + "/" + name;
+    entry.labelTemperature = prefix + "/TEMPERATURE_C";
+    entry.labelCurrent = prefix + "/CURRENT_A";
+    entry.labelPower = prefix + "/POWER_W";
+    entry.labelHeadroom = prefix + "/HEADROOM";
+    entry.labelLimit = prefix + "/LIMIT_A";
+    entry.labelHold = prefix + "/HOLD_A";
+
+    entries.push_back(entry);
+    samples.push_back({0.0, 0.0, 0.0});
+    return allocator.addMotor(priority, holdCurrentAmps);
+  }
+
+  void MotorBudget::periodic() {
+    for (size_t i = 0; i < entries.size(); i++) {
+      vex::motor* motor = entries[i].motor;
+      samples[i].temperatureC = motor->temperature(vex::temperatureUnits::celsius);
+      samples[i].currentAmps = motor->current(vex::currentUnits::amp);
+      samples[i].velocityRPM = motor->velocity(vex::rpm);
+      entries[i].powerWatts = motor->power(vex::powerUnits::watt);
+    }
+
+    allocator.allocate(samples, vex::timer::system());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+      entries[i].motor->setMaxTorque(allocator.getLimitAmps(i), 
+        vex::currentUnits::amp);
+    }
+  }
+
+  void MotorBudget::printTelemetry() {
+    double allocatedAmps = 0.0;
+    for (size_t i = 0; i < entries.size(); i++) {
+      Entry& entry = entries[i];
+      Telemetry::writeOutput(entry.labelTemperature, samples[i].temperatureC);
+      Telemetry::writeOutput(entry.labelCurrent, samples[i].currentAmps);
+      Telemetry::writeOutput(entry.labelPower, entry.powerWatts);
+      Telemetry::writeOutput(entry.labelHeadroom, allocator.getHeadroom(i));
+      Telemetry::writeOutput(entry.labelLimit, allocator.getLimitAmps(i));
+      Telemetry::writeOutput(entry.labelHold, allocator.getHoldAmps(i));
+      allocatedAmps += allocator.getLimitAmps(i);
+    }
+    Telemetry::writeOutput(labelAllocated, allocatedAmps);
+  }
+
+  double MotorBudget::getSpeedScale(int index) {
+    return allocator.getSpeedScale(index);
+  }
+
+  double MotorBudget::getLimitAmps(int index) {
+    return allocator.getLimitAmps(index);
+  }
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: config.cpp
+// Description: Saves and loads a fixed-size block of settings on the SD card.
+// The file layout is in configblock.h.
+
+#include "lib/config.h"
+#include "lib/configblock.h"
+#include <vector>
+
+namespace lib {
+  ConfigFile::ConfigFile(const std::string& fileName, uint32_t version)
+  : FILE_NAME(fileName),
+    VERSION(version) {}
+
+  bool ConfigFile::save(const void* data, uint32_t size) {
+    if (!Brain.SDcard.isInserted()) {
+      return false;
+    }
+
+    std::vector<uint8_t> contents = packConfig(VERSION, data, size);
+    int32_t written = Brain.SDcard.savefile(FILE_NAME.c_str(), 
+      contents.data(), contents.size());
+    return written == (int32_t) contents.size();
+  }
+
+  bool ConfigFile::load(void* data, uint32_t size) {
+    if (!Brain.SDcard.isInserted() || !Brain.SDcard.exists(FILE_NAME.c_str())) {
+      return false;
+    }
+
+    std::vector<uint8_t> contents(packedConfigSize(size));
+    int32_t read = Brain.SDcard.loadfile(FILE_NAME.c_str(), 
+      contents.data(), contents.size());
+    if (read != (int32_t) contents.size()) {
+      return false;
+    }
+    return unpackConfig(contents, VERSION, data, size);
+  }
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: configblock.cpp
+// Description: Layout of a saved block of settings, with enough of a header to
+// reject files that are stale or corrupted. Free of device calls so the
+// host-side tools can read and write the same files the robot does.
+
+#include "lib/configblock.h"
+#include <string.h>
+
+namespace lib {
+  struct ConfigHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t checksum;
+  };
+
+  // "SPCF" in ASCII
+  const uint32_t CONFIG_MAGIC = 0x53504346;
+
+  // 32-bit FNV-1a, plenty to catch a truncated or scribbled-on file
+  uint32_t checksum(const uint8_t* data, uint32_t size) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < size; i++) {
+      hash ^= data[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  std::vector<uint8_t> packConfig(uint32_t version, const void* data, 
+    uint32_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    ConfigHeader header = {CONFIG_MAGIC, version, size, checksum(bytes, size)};
+
+    std::vector<uint8_t> contents(packedConfigSize(size));
+    memcpy(contents.data(), &header, sizeof(ConfigHeader));
+    memcpy(contents.data() + sizeof(ConfigHeader), bytes, size);
+    return contents;
+  }
+
+  bool unpackConfig(const std::vector<uint8_t>& contents, uint32_t version, 
+    void* data, uint32_t size) {
+    if (contents.size() != packedConfigSize(size)) {
+      return false;
+    }
+
+    ConfigHeader header;
+    memcpy(&header, contents.data(), sizeof(ConfigHeader));
+    const uint8_t* bytes = contents.data() + sizeof(ConfigHeader);
+    if (header.magic != CONFIG_MAGIC || header.version != version 
+        || header.size != size || header.checksum != checksum(bytes, size)) {
+      return false;
+    }
+
+    memcpy(data, bytes, size);
+    return true;
+  }
+
+  uint32_t packedConfigSize(uint32_t size) {
+    return sizeof(ConfigHeader) + size;
+  }
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: feedforward.cpp
+// Description: Voltage feedforward for a DC motor mechanism,
+// V = kS * sign(v) + kV * v + kA * a, and a least-squares fit for its gains.
+
+#include "lib/feedforward.h"
+#include <cmath>
+
+namespace lib {
+  Feedforward::Feedforward(double kS, double kV, double kA)
+  : kS(kS), kV(kV), kA(kA) {}
+
+  double Feedforward::calculate(double velocity, double acceleration) {
+    double sign = 0.0;
+    if (velocity > 0.0) {
+      sign = 1.0;
+    } else if (velocity < 0.0) {
+      sign = -1.0;
+    }
+    return kS * sign + kV * velocity + kA * acceleration;
+  }
+
+  bool Feedforward::fit(const std::vector<FeedforwardSample>& quasistatic,
+    const std::vector<FeedforwardSample>& step, Feedforward& result) {
+    // Ordinary least squares of |V| against |v|, the intercept is kS
+    int count = 0;
+    double sumV = 0.0;
+    double sumVolts = 0.0;
+    double sumVV = 0.0;
+    double sumVVolts = 0.0;
+    for (const FeedforwardSample& sample : quasistatic) {
+      double velocity = std::fabs(sample.velocity);
+      if (velocity < MIN_VELOCITY) {
+        continue;
+      }
+      double volts = std::fabs(sample.volts);
+      count++;
+      sumV += velocity;
+      sumVolts += volts;
+      sumVV += velocity * velocity;
+      sumVVolts += velocity * volts;
+    }
+
+    double denominator = count * sumVV - sumV * sumV;
+    if (count < MIN_SAMPLES || denominator <= 0.0) {
+      return false;
+    }
+    double kV = (count * sumVVolts - sumV * sumVolts) / denominator;
+    double kS = (sumVolts - kV * sumV) / count;
+
+    // kA through the origin on the voltage kS and kV can't explain
+    int accelerationCount = 0;
+    double sumAA = 0.0;
+    double sumAResidual = 0.0;
+    for (const FeedforwardSample& sample : step) {
+      if (std::fabs(sample.acceleration) < MIN_ACCELERATION
+          || std::fabs(sample.velocity) < MIN_VELOCITY) {
+        continue;
+      }
+      double sign = sample.velocity > 0.0 ? 1.0 : -1.0;
+      double residual = sample.volts - kS * sign - kV * sample.velocity;
+      accelerationCount++;
+      sumAA += sample.acceleration * sample.acceleration;
+      sumAResidual += sample.acceleration * residual;
+    }
+
+    double kA = 0.0;
+    if (accelerationCount >= MIN_SAMPLES && sumAA > 0.0) {
+      kA = std::fmax(0.0, sumAResidual / sumAA);
+    }
+
+    result = Feedforward(kS, kV, kA);
+    return true;
+  }
+}
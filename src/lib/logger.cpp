@@ -0,0 +1,69 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: logger.cpp
+// Description: Records every device reading to the SD card, along with what
+// each control loop did with it, so that a run from the field can be replayed
+// on a computer.
+
+#include "lib/logger.h"
+
+namespace lib {
+  Logger::Logger(const std::string& fileName)
+  : FILE_NAME(fileName),
+    recording(false) {
+    buffer.reserve(BUFFER_FRAMES);
+  }
+
+  bool Logger::startRecording() {
+    if (!Brain.SDcard.isInserted()) {
+      return false;
+    }
+
+    LogHeader header = {LOG_MAGIC, LOG_VERSION, sizeof(SensorFrame)};
+    int32_t written = Brain.SDcard.savefile(FILE_NAME.c_str(),
+      reinterpret_cast<uint8_t*>(&header), sizeof(LogHeader));
+
+    bufferLock.lock();
+    buffer.clear();
+    recording = written == sizeof(LogHeader);
+    bufferLock.unlock();
+    return recording;
+  }
+
+  void Logger::record(const SensorFrame& frame) {
+    if (!recording) {
+      return;
+    }
+
+    bufferLock.lock();
+    buffer.push_back(frame);
+    if (buffer.size() >= BUFFER_FRAMES) {
+      writeBuffer();
+    }
+    bufferLock.unlock();
+  }
+
+  void Logger::flush() {
+    if (!recording) {
+      return;
+    }
+
+    bufferLock.lock();
+    writeBuffer();
+    bufferLock.unlock();
+  }
+
+  void Logger::writeBuffer() {
+    if (buffer.empty()) {
+      return;
+    }
+
+    Brain.SDcard.appendfile(FILE_NAME.c_str(),
+      reinterpret_cast<uint8_t*>(buffer.data()),
+      buffer.size() * sizeof(SensorFrame));
+    buffer.clear();
+  }
+}
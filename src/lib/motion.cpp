@@ -0,0 +1,105 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: motion.cpp
+// Description: Profiled drive and turn controllers. They only see numbers in
+// and out, so the drive subsystem, the replay tool and the simulator all run
+// the exact same logic.
+
+#include "lib/motion.h"
+#include "tuning.h"
+#include <cmath>
+
+namespace lib {
+  DriveGains defaultDriveGains() {
+    DriveGains gains = {
+      tuning::DRIVE_MAX_VELOCITY_MM_PER_SEC,
+      tuning::DRIVE_MAX_ACCELERATION_MM_PER_SEC2,
+      tuning::DRIVE_POSITION_KP,
+      tuning::DRIVE_POSITION_TOLERANCE_MM,
+      tuning::DRIVE_SETTLE_TIMEOUT_MS
+    };
+    return gains;
+  }
+
+  TurnGains defaultTurnGains() {
+    TurnGains gains = {
+      tuning::TURN_MAX_VELOCITY_DEG_PER_SEC,
+      tuning::TURN_MAX_ACCELERATION_DEG_PER_SEC2,
+      tuning::TURN_KP,
+      tuning::TURN_KI,
+      tuning::TURN_KD,
+      tuning::TURN_TOLERANCE_DEG,
+      tuning::TURN_RATE_TOLERANCE_DEG_PER_SEC,
+      tuning::TURN_SETTLE_TIMEOUT_MS
+    };
+    return gains;
+  }
+
+  ProfiledDrive::ProfiledDrive(double distanceMM, const DriveGains& gains)
+  : profile(distanceMM, gains.maxVelocityMMPerSec, 
+      gains.maxAccelerationMMPerSec2),
+    gains(gains) {}
+
+  DriveCommand ProfiledDrive::calculate(double elapsedSeconds,
+    double leftTravelMM, double rightTravelMM) {
+    ProfileState state = profile.sample(elapsedSeconds);
+    double leftError = state.position - leftTravelMM;
+    double rightError = state.position - rightTravelMM;
+
+    DriveCommand command;
+    bool profileDone = elapsedSeconds >= profile.totalTimeSeconds();
+    bool settled = profileDone
+      && std::fabs(leftError) < gains.toleranceMM
+      && std::fabs(rightError) < gains.toleranceMM;
+    bool timedOut = elapsedSeconds * 1000.0 
+      >= profile.totalTimeSeconds() * 1000.0 + gains.settleTimeoutMS;
+    command.done = settled || timedOut;
+
+    command.leftVelocityMMPerSec = 
+      state.velocity + gains.positionKP * leftError;
+    command.rightVelocityMMPerSec = 
+      state.velocity + gains.positionKP * rightError;
+    command.accelerationMMPerSec2 = state.acceleration;
+    return command;
+  }
+
+  ProfiledTurn::ProfiledTurn(double angleDegrees, const TurnGains& gains)
+  : profile(angleDegrees, gains.maxVelocityDegPerSec, 
+      gains.maxAccelerationDegPerSec2),
+    gains(gains),
+    controller(gains.kP, gains.kI, gains.kD),
+    lastSeconds(0.0) {}
+
+  TurnCommand ProfiledTurn::calculate(double elapsedSeconds,
+    double turnedDegrees, double rateDegPerSec) {
+    double dt = elapsedSeconds - lastSeconds;
+    lastSeconds = elapsedSeconds;
+    ProfileState state = profile.sample(elapsedSeconds);
+    double error = state.position - turnedDegrees;
+
+    TurnCommand command;
+    bool profileDone = elapsedSeconds >= profile.totalTimeSeconds();
+    bool settled = profileDone
+      && std::fabs(error) < gains.toleranceDegrees
+      && std::fabs(rateDegPerSec) < gains.rateToleranceDegPerSec;
+    bool timedOut = elapsedSeconds * 1000.0 
+      >= profile.totalTimeSeconds() * 1000.0 + gains.settleTimeoutMS;
+    command.done = settled || timedOut;
+
+    command.velocityDegPerSec = 
+      state.velocity + controller.calculate(error, dt);
+    command.accelerationDegPerSec2 = state.acceleration;
+    return command;
+  }
+
+  double approachDemandPct(double distanceMM, double stopDistanceMM,
+    double speedPct) {
+    if (distanceMM > stopDistanceMM) {
+      return speedPct;
+    }
+    return 0.0;
+  }
+}
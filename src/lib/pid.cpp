@@ -0,0 +1,35 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: pid.cpp
+// Description: Plain PID controller on an error signal.
+
+#include "lib/pid.h"
+
+namespace lib {
+  PID::PID(double kP, double kI, double kD)
+  : kP(kP), kI(kI), kD(kD),
+    integral(0.0),
+    lastError(0.0),
+    hasLastError(false) {}
+
+  double PID::calculate(double error, double dtSeconds) {
+    double derivative = 0.0;
+    if (hasLastError && dtSeconds > 0.0) {
+      integral += error * dtSeconds;
+      derivative = (error - lastError) / dtSeconds;
+    }
+    lastError = error;
+    hasLastError = true;
+
+    return kP * error + kI * integral + kD * derivative;
+  }
+
+  void PID::reset() {
+    integral = 0.0;
+    lastError = 0.0;
+    hasLastError = false;
+  }
+}
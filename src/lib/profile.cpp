@@ -0,0 +1,57 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: profile.cpp
+// Description: Trapezoidal motion profile from rest to rest.
+
+#include "lib/profile.h"
+#include <cmath>
+
+namespace lib {
+  TrapezoidProfile::TrapezoidProfile(
+    double distance, double maxVelocity, double maxAcceleration)
+  : distance(std::fabs(distance)),
+    direction(distance < 0.0 ? -1.0 : 1.0),
+    acceleration(maxAcceleration) {
+    // Distance covered speeding up to maxVelocity and slowing back down
+    double rampDistance = maxVelocity * maxVelocity / maxAcceleration;
+    if (rampDistance > this->distance) {
+      peakVelocity = std::sqrt(this->distance * maxAcceleration);
+      cruiseTime = 0.0;
+    } else {
+      peakVelocity = maxVelocity;
+      cruiseTime = (this->distance - rampDistance) / maxVelocity;
+    }
+    accelerationTime = peakVelocity / maxAcceleration;
+  }
+
+  ProfileState TrapezoidProfile::sample(double t) {
+    ProfileState state;
+    double decelerationStart = accelerationTime + cruiseTime;
+
+    if (t < accelerationTime) {
+      state = {0.5 * acceleration * t * t, acceleration * t, acceleration};
+    } else if (t < decelerationStart) {
+      double cruising = t - accelerationTime;
+      state = {0.5 * peakVelocity * accelerationTime + peakVelocity * cruising,
+        peakVelocity, 0.0};
+    } else if (t < totalTimeSeconds()) {
+      double remaining = totalTimeSeconds() - t;
+      state = {distance - 0.5 * acceleration * remaining * remaining,
+        acceleration * remaining, -acceleration};
+    } else {
+      state = {distance, 0.0, 0.0};
+    }
+
+    state.position *= direction;
+    state.velocity *= direction;
+    state.acceleration *= direction;
+    return state;
+  }
+
+  double TrapezoidProfile::totalTimeSeconds() {
+    return 2.0 * accelerationTime + cruiseTime;
+  }
+}
@@ -0,0 +1,325 @@
+// Copyright (c) 2025 barbute
+//
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: routines.cpp
+// Description: The autonomous routines, written against an interface rather
+// than the devices so the robot and the simulator run the exact same steps.
+
+#include "lib/routines.h"
+#include "lib/motion.h"
+#include "tuning.h"
+#include <cmath>
+
+namespace lib {
+  const float PICKUP_HEIGHT_MM = 0.0f;
+  const float CLEAR_TOP_BOX_HEIGHT_MM = 582.706f + 20.0f;
+  const float PLACE_CUP_HEIGHT_MM = 480.0f;
+  const float STOW_ELEVATOR_MM = 150.0f;
+  const float CLAW_OPEN_ROTATIONS = 0.8f;
+  const float CLAW_CLOSED_ROTATIONS = 0.31f;
+  // Top of the elevator's travel
+  const float MAX_ELEVATOR_HEIGHT_MM = 620.0f;
+
+  // Legs of the main auto from the start tile
+  const double FIRST_LEG_MM = 4800.0;
+  const double SECOND_LEG_MM = 4600.0;
+
+  RoutineSettings defaultRoutineSettings() {
+    RoutineSettings settings = {
+      (float) tuning::PICKUP_DISTANCE_MM,
+      (float) tuning::PREP_PLACE_DISTANCE_MM,
+      (float) tuning::PLACE_DISTANCE_MM,
+      PICKUP_HEIGHT_MM,
+      CLEAR_TOP_BOX_HEIGHT_MM,
+      PLACE_CUP_HEIGHT_MM,
+      STOW_ELEVATOR_MM,
+      CLAW_OPEN_ROTATIONS,
+      CLAW_CLOSED_ROTATIONS
+    };
+    return settings;
+  }
+
+  bool isValidRoutineSettings(const RoutineSettings& settings) {
+    // Written so that NaN fails every check
+    const float heights[] = {
+      settings.pickupHeightMM, settings.clearTopBoxHeightMM,
+      settings.placeCupHeightMM, settings.stowElevatorMM
+    };
+    for (float height : heights) {
+      if (!(height >= 0.0f && height <= MAX_ELEVATOR_HEIGHT_MM)) {
+        return false;
+      }
+    }
+
+    // The place step drives in from the prep distance to the place distance,
+    // and the cup is lowered into the box from above its rim
+    return settings.placeDistanceMM > 0.0f
+      && settings.pickupDistanceMM > 0.0f
+      && settings.prepPlaceDistanceMM > settings.placeDistanceMM
+      && settings.prepPlaceDistanceMM < 2000.0f
+      && settings.pickupDistanceMM < 2000.0f
+      && settings.clearTopBoxHeightMM > settings.placeCupHeightMM
+      && settings.clawClosedRotations >= 0.0f
+      && settings.clawOpenRotations > settings.clawClosedRotations
+      && settings.clawOpenRotations < 2.0f;
+  }
+
+  RoutineGains defaultRoutineGains() {
+    RoutineGains gains = {
+      tuning::DRIVE_SPEED_PCT,
+      tuning::APPROACH_TIMEOUT_MS,
+      tuning::SCAN_RATE_DEG_PER_SEC,
+      tuning::SCAN_APPROACH_MARGIN_MM
+    };
+    return gains;
+  }
+
+  bool hasDistinctSlots(const std::deque<BoxSlot>& slots) {
+    for (size_t i = 0; i < slots.size(); i++) {
+      for (size_t j = i + 1; j < slots.size(); j++) {
+        if (slots[i].headingDegrees == slots[j].headingDegrees
+            && slots[i].placeHeightMM == slots[j].placeHeightMM) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  Routines::Routines(SensorSource& sensors, RoutineRobot& robot,
+    const RoutineSettings& settings, const RoutineGains& gains)
+  : sensors(sensors),
+    robot(robot),
+    settings(settings),
+    gains(gains),
+    cupScan(tuning::SCAN_HALF_ARC_DEG, tuning::SCAN_BIN_DEG,
+      gains.scanRateDegPerSec * tuning::SCAN_SENSOR_LATENCY_MS / 1000.0) {}
+
+  void Routines::prepPickup(bool blocking) {
+    // Claw pre open
+    robot.setClawRotations(settings.clawOpenRotations, blocking);
+
+    // Elevator to pickup position
+    robot.setElevatorMM(settings.pickupHeightMM, blocking);
+  }
+
+  bool Routines::approach(double stopDistanceMM) {
+    uint16_t run = sensors.startControlRun();
+    double startMS = robot.timeMS();
+    while (true) {
+      SensorFrame frame = sensors.read();
+      double demandPercent = approachDemandPct(frame.distanceMM,
+        stopDistanceMM, gains.approachSpeedPct);
+
+      frame.controlMode = CONTROL_APPROACH;
+      frame.controlRun = run;
+      frame.setpoint = stopDistanceMM;
+      frame.leftOutput = demandPercent;
+      frame.rightOutput = demandPercent;
+      sensors.record(frame);
+      if (demandPercent == 0.0) {
+        break;
+      }
+      if (robot.timeMS() - startMS > gains.approachTimeoutMS) {
+        robot.stopDrive();
+        return false;
+      }
+
+      robot.drivePct(demandPercent);
+      robot.wait(5.0);
+    }
+    robot.stopDrive();
+    return true;
+  }
+
+  bool Routines::scanForCup(ScanTarget& target) {
+    double centerDegrees = sensors.read().rotationDegrees;
+    double endDegrees = centerDegrees + tuning::SCAN_HALF_ARC_DEG;
+    double timeoutMS =
+      2.0 * tuning::SCAN_HALF_ARC_DEG / gains.scanRateDegPerSec * 1000.0
+      + 1000.0;
+
+    robot.turnToAngle(-tuning::SCAN_HALF_ARC_DEG);
+
+    cupScan.clear();
+    uint16_t run = sensors.startControlRun();
+    double startMS = robot.timeMS();
+    while (robot.timeMS() - startMS < timeoutMS) {
+      SensorFrame frame = sensors.read();
+      bool done = frame.rotationDegrees >= endDegrees;
+      cupScan.addSample(frame.rotationDegrees - centerDegrees, frame.distanceMM);
+
+      frame.controlMode = CONTROL_SCAN;
+      frame.controlRun = run;
+      frame.setpoint = centerDegrees;
+      frame.leftOutput = done ? 0.0 : gains.scanRateDegPerSec;
+      frame.rightOutput = frame.leftOutput;
+      sensors.record(frame);
+      if (done) {
+        break;
+      }
+
+      robot.spinInPlace(gains.scanRateDegPerSec);
+      robot.wait(10.0);
+    }
+    robot.stopDrive();
+
+    if (!cupScan.findNearest(tuning::CUP_MIN_WIDTH_MM, tuning::CUP_MAX_WIDTH_MM,
+        tuning::SCAN_BEAM_WIDTH_DEG, target)) {
+      return false;
+    }
+
+    robot.turnToAngle(
+      centerDegrees + target.bearingDegrees - sensors.read().rotationDegrees);
+    return true;
+  }
+
+  bool Routines::runPickup(bool scanFirst) {
+    double startMS = robot.timeMS();
+    // Returns straight away if a pipelined prep already got there
+    prepPickup(true);
+
+    if (scanFirst) {
+      ScanTarget target;
+      if (!scanForCup(target)) {
+        robot.recordRun(RUN_PICKUP, robot.timeMS() - startMS, false);
+        return false;
+      }
+
+      // Cover most of the distance quickly, the creep below finishes it off
+      double approachMM = target.rangeMM - settings.pickupDistanceMM
+        - gains.scanApproachMarginMM;
+      if (approachMM > 0.0) {
+        robot.driveDistance(approachMM, true);
+      }
+    }
+
+    // Run until senses cup
+    if (!approach(settings.pickupDistanceMM)) {
+      robot.recordRun(RUN_PICKUP, robot.timeMS() - startMS, false);
+      return false;
+    }
+
+    // Claw close
+    robot.setClawRotations(settings.clawClosedRotations, true);
+
+    // Elevator to stow cup
+    robot.setElevatorMM(settings.stowElevatorMM, true);
+
+    robot.recordRun(RUN_PICKUP, robot.timeMS() - startMS, true);
+    return true;
+  }
+
+  bool Routines::runAutoPlace(double placeHeightMM, bool waitForElevator) {
+    double startMS = robot.timeMS();
+
+    // Drive to prep placing position
+    if (!approach(settings.prepPlaceDistanceMM)) {
+      robot.recordRun(RUN_PLACE, robot.timeMS() - startMS, false);
+      return false;
+    }
+
+    // Elevator raised to clearence
+    robot.setElevatorMM(settings.clearTopBoxHeightMM, true);
+
+    // Drive to place position. The approach coasts a little past its stopping
+    // distance, so go by what the sensor reads now that the robot is still,
+    // and finish the drive before lowering the cup onto the box.
+    double boxDistanceMM = std::fmin(sensors.read().distanceMM,
+      settings.prepPlaceDistanceMM);
+    robot.driveDistance(boxDistanceMM - settings.placeDistanceMM, true);
+
+    // Elevator lower to place
+    robot.setElevatorMM(placeHeightMM, true);
+
+    // Claw open
+    robot.setClawRotations(settings.clawOpenRotations, true);
+
+    // Elevator raise to clearence
+    robot.setElevatorMM(settings.clearTopBoxHeightMM, true);
+
+    // Claw close
+    robot.setClawRotations(settings.clawClosedRotations, true);
+
+    // Elevator lower to pickup while driving backwards
+    robot.setElevatorMM(settings.pickupHeightMM, false);
+    robot.driveDistance(-settings.prepPlaceDistanceMM, true);
+    if (waitForElevator) {
+      robot.setElevatorMM(settings.pickupHeightMM, true);
+    }
+
+    robot.recordRun(RUN_PLACE, robot.timeMS() - startMS, true);
+    return true;
+  }
+
+  void Routines::driveToCups() {
+    // Raise claw to be out of way
+    robot.setElevatorMM(settings.stowElevatorMM, true);
+
+    // Drive until on side of color row
+    robot.driveDistance(FIRST_LEG_MM, true);
+
+    // Turn left 90 deg
+    robot.turnToAngle(-90.0);
+
+    // Drive until on correct pad
+    robot.driveDistance(SECOND_LEG_MM, true);
+
+    // Turn left 90 deg
+    robot.turnToAngle(-90.0);
+  }
+
+  bool Routines::runMainAuto() {
+    driveToCups();
+
+    // Run to pickup the cup, nothing to score if it was never found
+    if (!runPickup(true)) {
+      return false;
+    }
+
+    // Turn left 90 deg
+    robot.turnToAngle(-90.0);
+
+    // Score cup
+    return runAutoPlace(settings.placeCupHeightMM, true);
+  }
+
+  double Routines::runCupPipeline(std::deque<CupTarget> cups,
+    std::deque<BoxSlot> slots) {
+    double pipelineStartMS = robot.timeMS();
+    int scored = 0;
+
+    while (!cups.empty() && !slots.empty()) {
+      double cupStartMS = robot.timeMS();
+      CupTarget cup = cups.front();
+      cups.pop_front();
+
+      // Claw and elevator get ready while the robot turns toward the cup
+      prepPickup(false);
+      robot.turnToHeading(cup.headingDegrees);
+      if (cup.leadInMM > 0.0) {
+        robot.driveDistance(cup.leadInMM, true);
+      }
+
+      if (!runPickup(true)) {
+        robot.recordRun(RUN_CUP, robot.timeMS() - cupStartMS, false);
+        continue;
+      }
+
+      BoxSlot slot = slots.front();
+      robot.turnToHeading(slot.headingDegrees);
+      bool placed = runAutoPlace(slot.placeHeightMM, false);
+      robot.recordRun(RUN_CUP, robot.timeMS() - cupStartMS, placed);
+      if (!placed) {
+        break;
+      }
+      slots.pop_front();
+      scored++;
+    }
+
+    double minutes = (robot.timeMS() - pipelineStartMS) / 60000.0;
+    return minutes > 0.0 ? scored / minutes : 0.0;
+  }
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: runlog.cpp
+// Description: Keeps a routine's run history on the SD card, so success rate
+// and cycle-time percentiles build up across power cycles instead of starting
+// over with every match.
+
+#include "lib/runlog.h"
+#include "lib/telemetry.h"
+#include <vector>
+
+namespace lib {
+  RunLog::RunLog(const std::string& name)
+  : FILE_NAME(name + "_runs.bin"),
+    stats(name),
+    fileReady(false),
+    labelRuns(name + "/RUNS"),
+    labelSuccessRate(name + "/SUCCESS_RATE"),
+    labelP50(name + "/P50_MS"),
+    labelP95(name + "/P95_MS"),
+    labelP99(name + "/P99_MS"),
+    labelExpected(name + "/MS_PER_SUCCESS") {}
+
+  bool RunLog::load() {
+    if (!Brain.SDcard.isInserted() || !Brain.SDcard.exists(FILE_NAME.c_str())) {
+      return false;
+    }
+
+    int32_t size = Brain.SDcard.size(FILE_NAME.c_str());
+    if (size < (int32_t) sizeof(RunLogHeader)) {
+      return false;
+    }
+    std::vector<uint8_t> contents(size);
+    int32_t read = Brain.SDcard.loadfile(FILE_NAME.c_str(), 
+      contents.data(), contents.size());
+    if (read != size) {
+      return false;
+    }
+
+    // A record cut off by a power loss mid-write is dropped
+    int32_t offset = addRunLog(contents.data(), size, stats);
+    if (offset < 0) {
+      return false;
+    }
+
+    // and cut from the file, or every later append would land out of step
+    fileReady = offset == size || Brain.SDcard.savefile(FILE_NAME.c_str(),
+      contents.data(), offset) == offset;
+    return true;
+  }
+
+  void RunLog::record(double durationMS, bool success) {
+    stats.record(durationMS, success);
+    if (!Brain.SDcard.isInserted()) {
+      return;
+    }
+
+    // Starts the file over if load() found nothing usable
+    if (!fileReady) {
+      RunLogHeader header = {RUN_LOG_MAGIC, RUN_LOG_VERSION,
+        sizeof(RunLogRecord)};
+      int32_t written = Brain.SDcard.savefile(FILE_NAME.c_str(), 
+        reinterpret_cast<uint8_t*>(&header), sizeof(RunLogHeader));
+      fileReady = written == sizeof(RunLogHeader);
+      if (!fileReady) {
+        return;
+      }
+    }
+
+    RunLogRecord run = {(float) durationMS, success ? 1u : 0u};
+    Brain.SDcard.appendfile(FILE_NAME.c_str(), 
+      reinterpret_cast<uint8_t*>(&run), sizeof(RunLogRecord));
+  }
+
+  void RunLog::printTelemetry() {
+    Telemetry::writeOutput(labelRuns, stats.runCount());
+    Telemetry::writeOutput(labelSuccessRate, stats.successRate());
+    Telemetry::writeOutput(labelP50, stats.percentileMS(50.0));
+    Telemetry::writeOutput(labelP95, stats.percentileMS(95.0));
+    Telemetry::writeOutput(labelP99, stats.percentileMS(99.0));
+    Telemetry::writeOutput(labelExpected, stats.expectedMSPerSuccess());
+  }
+
+  RunStats& RunLog::getStats() {
+    return stats;
+  }
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: scan.cpp
+// Description: Polar range histogram built from distance readings taken while
+// the robot sweeps through an arc, used to find the bearing of a cup.
+
+#include "lib/scan.h"
+#include <cmath>
+
+namespace lib {
+  // Bound by reference when filling rangesMM, so they need a definition
+  constexpr double PolarScan::SAME_OBJECT_MM;
+  constexpr double PolarScan::NO_RETURN_MM;
+
+  PolarScan::PolarScan(double halfArcDegrees, double binDegrees,
+    double latencyDegrees)
+  : HALF_ARC_DEGREES(halfArcDegrees),
+    BIN_DEGREES(binDegrees),
+    LATENCY_DEGREES(latencyDegrees),
+    rangesMM((int) std::ceil(2.0 * halfArcDegrees / binDegrees), NO_RETURN_MM) {}
+
+  void PolarScan::clear() {
+    for (double& range : rangesMM) {
+      range = NO_RETURN_MM;
+    }
+  }
+
+  void PolarScan::addSample(double bearingDegrees, double rangeMM) {
+    int bin = (int) std::floor(
+      (bearingDegrees - LATENCY_DEGREES + HALF_ARC_DEGREES) / BIN_DEGREES);
+    if (bin < 0 || bin >= (int) rangesMM.size()) {
+      return;
+    }
+    rangesMM[bin] = std::fmin(rangesMM[bin], rangeMM);
+  }
+
+  bool PolarScan::findNearest(double minWidthMM, double maxWidthMM,
+    double beamWidthDegrees, ScanTarget& target) {
+    bool found = false;
+    int size = rangesMM.size();
+    int start = 0;
+
+    while (start < size) {
+      if (rangesMM[start] >= NO_RETURN_MM) {
+        start++;
+        continue;
+      }
+
+      // Grow the return while neighbouring bins stay at a similar range
+      int end = start;
+      double nearestMM = rangesMM[start];
+      while (end + 1 < size && rangesMM[end + 1] < NO_RETURN_MM
+          && std::fabs(rangesMM[end + 1] - rangesMM[end]) < SAME_OBJECT_MM) {
+        end++;
+        nearestMM = std::fmin(nearestMM, rangesMM[end]);
+      }
+
+      // A return touching the edge of the arc may be cut off, so its width
+      // can't be trusted
+      bool clipped = start == 0 || end == size - 1;
+      double spanDegrees = 
+        std::fmax(0.0, (end - start + 1) * BIN_DEGREES - beamWidthDegrees);
+      double widthMM = nearestMM * spanDegrees * M_PI / 180.0;
+
+      if (!clipped && widthMM >= minWidthMM && widthMM <= maxWidthMM
+          && (!found || nearestMM < target.rangeMM)) {
+        target.bearingDegrees = (binBearing(start) + binBearing(end)) / 2.0;
+        target.rangeMM = nearestMM;
+        target.widthMM = widthMM;
+        found = true;
+      }
+
+      start = end + 1;
+    }
+    return found;
+  }
+
+  double PolarScan::binBearing(int bin) {
+    return -HALF_ARC_DEGREES + (bin + 0.5) * BIN_DEGREES;
+  }
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: startup.cpp
+// Description: Runs initialization tasks side by side and waits for all of
+// them. A task can wait for others to finish before it starts, so startup
+// takes as long as the slowest chain of tasks rather than the sum of all of
+// them.
+
+#include "lib/startup.h"
+#include "lib/telemetry.h"
+
+namespace lib {
+  Startup::Startup(const std::string& name)
+  : NAME(name),
+    totalMS(0.0) {}
+
+  int Startup::addTask(const std::string& name, TaskFunction function, 
+    double timeoutMS, const std::vector<int>& after) {
+    Task task;
+    task.function = function;
+    task.timeoutMS = timeoutMS;
+    // Anything else could wait on itself, or on a task that waits on it
+    for (int index : after) {
+      if (index >= 0 && index < (int) tasks.size()) {
+        task.after.push_back(index);
+      }
+    }
+    task.thread = nullptr;
+    task.startMS = 0.0;
+    task.done = false;
+    task.succeeded = false;
+    task.timedOut = false;
+    task.durationMS = 0.0;
+    task.labelDuration = NAME + "/" + name + "/DURATION_MS";
+    task.labelSucceeded = NAME + "/" + name + "/SUCCEEDED";
+    tasks.push_back(task);
+    return tasks.size() - 1;
+  }
+
+  bool Startup::run() {
+    // Threads hold pointers into tasks, so it can't grow from here on
+    vex::timer timer;
+    bool waiting = true;
+    while (waiting) {
+      waiting = false;
+      double elapsedMS = timer.time(vex::msec);
+      for (Task& task : tasks) {
+        if (isFinished(task)) {
+          continue;
+        }
+        waiting = true;
+
+        if (task.thread == nullptr) {
+          bool ready = true;
+          for (int index : task.after) {
+            ready = ready && isFinished(tasks[index]);
+          }
+          if (ready) {
+            task.startMS = elapsedMS;
+            task.thread = new vex::thread(runTask, &task);
+          }
+          continue;
+        }
+
+        if (elapsedMS - task.startMS > task.timeoutMS) {
+          task.thread->interrupt();
+          task.timedOut = true;
+          task.durationMS = elapsedMS - task.startMS;
+        }
+      }
+      if (waiting) {
+        wait(5, vex::msec);
+      }
+    }
+    totalMS = timer.time(vex::msec);
+
+    bool allSucceeded = true;
+    for (Task& task : tasks) {
+      delete task.thread;
+      task.thread = nullptr;
+      allSucceeded = allSucceeded && task.succeeded && !task.timedOut;
+    }
+    return allSucceeded;
+  }
+
+  void Startup::printTelemetry() {
+    for (Task& task : tasks) {
+      Telemetry::writeOutput(task.labelDuration, task.durationMS);
+      Telemetry::writeOutput(task.labelSucceeded, 
+        task.succeeded && !task.timedOut);
+    }
+    Telemetry::writeOutput(labelTotal, totalMS);
+  }
+
+  bool Startup::isFinished(const Task& task) {
+    return task.done || task.timedOut;
+  }
+
+  int Startup::runTask(void* argument) {
+    Task* task = static_cast<Task*>(argument);
+    vex::timer timer;
+    task->succeeded = task->function();
+    task->durationMS = timer.time(vex::msec);
+    task->done = true;
+    return 0;
+  }
+}
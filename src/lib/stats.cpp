@@ -0,0 +1,81 @@
+// Copyright (c) 2025 barbute
+// 
+// This file is part of sojourner-spud and is licensed under the MIT License.
+// See the LICENSE file in the root of the project for more information.
+//
+// File: stats.cpp
+// Description: Tracks how often a routine succeeds and how long it takes. Free
+// of device calls so the host-side tools can report the same numbers.
+
+#include "lib/stats.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+namespace lib {
+  RunStats::RunStats(const std::string& name)
+  : NAME(name),
+    failures(0),
+    totalMS(0.0) {}
+
+  void RunStats::record(double durationMS, bool success) {
+    totalMS += durationMS;
+    if (success) {
+      successDurationsMS.push_back(durationMS);
+    } else {
+      failures++;
+    }
+  }
+
+  int RunStats::runCount() {
+    return successDurationsMS.size() + failures;
+  }
+
+  double RunStats::successRate() {
+    if (runCount() == 0) {
+      return 0.0;
+    }
+    return (double) successDurationsMS.size() / runCount();
+  }
+
+  double RunStats::percentileMS(double percentile) {
+    if (successDurationsMS.empty()) {
+      return 0.0;
+    }
+
+    std::vector<double> sorted = successDurationsMS;
+    std::sort(sorted.begin(), sorted.end());
+
+    int rank = (int) std::ceil(percentile / 100.0 * sorted.size());
+    rank = std::max(1, std::min(rank, (int) sorted.size()));
+    return sorted[rank - 1];
+  }
+
+  double RunStats::expectedMSPerSuccess() {
+    if (successDurationsMS.empty()) {
+      return 0.0;
+    }
+    return totalMS / successDurationsMS.size();
+  }
+
+  int32_t addRunLog(const uint8_t* contents, int32_t size, RunStats& stats) {
+    if (size < (int32_t) sizeof(RunLogHeader)) {
+      return -1;
+    }
+    RunLogHeader header;
+    memcpy(&header, contents, sizeof(RunLogHeader));
+    if (header.magic != RUN_LOG_MAGIC || header.version != RUN_LOG_VERSION
+        || header.recordSize != sizeof(RunLogRecord)) {
+      return -1;
+    }
+
+    int32_t offset = sizeof(RunLogHeader);
+    for (; offset + (int32_t) sizeof(RunLogRecord) <= size;
+        offset += sizeof(RunLogRecord)) {
+      RunLogRecord run;
+      memcpy(&run, contents + offset, sizeof(RunLogRecord));
+      stats.record(run.durationMS, run.success != 0);
+    }
+    return offset;
+  }
+}
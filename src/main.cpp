@@ -11,9 +11,18 @@
 #include "subsystems/elevator.h"
 #include "subsystems/intake.h"
 #include "lib/telemetry.h"
+#include "lib/logger.h"
+#include "lib/runlog.h"
+#include "lib/routines.h"
+#include "lib/budget.h"
+#include "lib/config.h"
+#include "lib/startup.h"
+#include "tuning.h"
 #include <iostream>
 #include <sstream>
 #include <array>
+#include <deque>
+#include <vector>
 
 using namespace vex;
 using signature = vision::signature;
@@ -27,8 +36,19 @@ std::string systemName = "S";
 const bool RUN_AUTONOMOUS = false;
 // Set to true before running the graded auto
 const bool RUN_MAIN_AUTO = true;
-// Set to false before running teleop
+// Set to true to keep scoring cups at the calibrated cup targets and box
+// slots after the first
+const bool RUN_MULTI_CUP_AUTO = false;
+// Set to false before running teleop. Walks through sampling each pad color,
+// adjusting approach distances, elevator heights and claw positions and
+// measuring the multi-cup auto's targets, then saves them to the SD card.
 const bool RUN_CALIBRATION_MODE = false;
+// Set to true to log every device reading to the SD card, along with the
+// outputs of every control loop tick. Replay the log on a computer with
+// sim/replay.
+const bool RECORD_SENSORS = false;
+// Set to true to fit the drive feedforward, needs a few meters of clear space
+const bool RUN_DRIVE_CHARACTERIZATION = false;
 
 std::string driveName = "D";
 vex::motor leftMotor(vex::PORT3, vex::gearSetting::ratio18_1, true);
@@ -42,16 +62,14 @@ vex::distance distanceSensor(vex::PORT10);
 
 std::string elevatorName = "E";
 vex::motor elevatorMotor(vex::PORT2, vex::gearSetting::ratio18_1, false);
-vex::digital_in upperLimitSwitch(Brain.ThreeWirePort.E);
-vex::digital_in lowerLimitSwitch(Brain.ThreeWirePort.F);
+vex::limit upperLimitSwitch(Brain.ThreeWirePort.E);
+vex::limit lowerLimitSwitch(Brain.ThreeWirePort.F);
 
 std::string intakeName = "I";
 vex::motor intakeMotor(vex::PORT1, vex::gearSetting::ratio18_1, false);
 // TODO Add this limit switch as it's currently not on the robot yet
 vex::digital_in surfaceLimitSwitch(Brain.ThreeWirePort.D);
 
-const double DRIVE_SPEED_PCT = 20.0;
-
 const std::string ROW = "1"; // 1 or 2
 const std::string COLOR = "GREEN"; // GREEN, BLUE, or PINK
 const bool TARGET_SINGLE_COLOR = true;
@@ -73,203 +91,768 @@ const std::array<double, 3> COLOR_ROW_2_GREEN = {1650.0, 1750.0, 1400.0};
 const std::array<double, 3> COLOR_ROW_2_BLUE = {5550.0, 4700.0, 5300.0};
 const std::array<double, 3> COLOR_ROW_2_PINK = {7300.0, 1700.0, 2910.0};
 
-const double PICKUP_DISTANCE_MM = 77.0;
-const double PREP_PLACE_DISTANCE_MM = 270.0;
-const double PLACE_DISTANCE_MM = 17.0;
-
-const double PICKUP_HEIGHT_MM = 0.0;
-const double CLEAR_TOP_BOX_HEIGHT_MM = 582.706 + 20.0;
-const double PLACE_CUP_HEIGHT_MM = 480.0;
-const double STOW_ELEVATOR_MM = 150.0;
-
-const double CLAW_OPEN_ROTATIONS = 0.8;
-const double CLAW_CLOSED_ROTATIONS = 0.31;
+// Colors the calibration mode samples, in the order it asks for them
+enum CalibratedColor {
+  ROW_1_GREEN, ROW_1_BLUE, ROW_1_PINK,
+  ROW_2_GREEN, ROW_2_BLUE, ROW_2_PINK,
+  WHITE, SINGLE_COLOR,
+  CALIBRATED_COLOR_COUNT
+};
+const char* CALIBRATED_COLOR_NAMES[CALIBRATED_COLOR_COUNT] = {
+  "ROW 1 GREEN", "ROW 1 BLUE", "ROW 1 PINK",
+  "ROW 2 GREEN", "ROW 2 BLUE", "ROW 2 PINK",
+  "WHITE", "SINGLE COLOR"
+};
+
+struct ColorCentroid {
+  float red;
+  float green;
+  float blue;
+  // RMS distance of the calibration samples from the centroid
+  float spread;
+};
+
+// The pad colors calibration samples. Saved to the SD card as is, so bump
+// ROBOT_CONFIG_VERSION whenever the layout changes. The routines' settings are
+// saved on their own, see lib::RoutineSettings.
+struct RobotConfig {
+  ColorCentroid colors[CALIBRATED_COLOR_COUNT];
+};
+
+const uint32_t ROBOT_CONFIG_VERSION = 1;
+// Used for the compiled-in colors, which were never measured for spread
+const float DEFAULT_COLOR_SPREAD = 300.0;
+// A reading matches a color if it is within this many spreads of it
+const double COLOR_MATCH_SPREADS = 3.0;
+const int COLOR_SAMPLES = 50;
+const double DISTANCE_STEP_MM = 5.0;
+const double ROTATION_STEP = 0.01;
+const double LEAD_IN_STEP_MM = 50.0;
+// Joystick scale while lining up on a cup or box during calibration
+const double CALIBRATION_DRIVE_SCALE = 0.4;
+
+lib::ConfigFile robotConfigFile("config.bin", ROBOT_CONFIG_VERSION);
+RobotConfig robotConfig;
+// The host-side tools read and write this file too, so a simulated or tuned
+// run uses the same values as the robot
+lib::ConfigFile routineSettingsFile("routine.bin", 
+  lib::ROUTINE_SETTINGS_VERSION);
+lib::RoutineSettings routineSettings;
+
+const double OPTICAL_WARM_UP_MS = 200.0;
+const double CLAW_ZEROING_TIMEOUT_MS = 1000.0;
+const double INERTIAL_CALIBRATION_TIMEOUT_MS = 3000.0;
+
+// Where the multi-cup auto looks for cups and puts them, measured in
+// calibration mode. Headings come from the inertial sensor, so measure them
+// with the robot switched on at the start position, the same as for a match.
+// Saved to the SD card as is, so bump PIPELINE_TARGETS_VERSION whenever the
+// layout changes.
+const int PIPELINE_TARGET_COUNT = 3;
+struct PipelineTargets {
+  lib::CupTarget cups[PIPELINE_TARGET_COUNT];
+  lib::BoxSlot slots[PIPELINE_TARGET_COUNT];
+  // Nothing is set until calibration measures it, and the multi-cup auto
+  // skips whatever is unset
+  uint8_t cupSet[PIPELINE_TARGET_COUNT];
+  uint8_t slotSet[PIPELINE_TARGET_COUNT];
+};
+
+const uint32_t PIPELINE_TARGETS_VERSION = 1;
+// Where calibration starts from. After the two legs of the main auto the cups
+// are at 180 and the boxes at 90.
+const lib::CupTarget DEFAULT_CUP_TARGET = {180.0, 0.0};
+const double DEFAULT_SLOT_HEADING_DEGREES = 90.0;
+
+lib::ConfigFile pipelineTargetsFile("targets.bin", PIPELINE_TARGETS_VERSION);
+PipelineTargets pipelineTargets;
 
 std::string labelDistance = "distance";
 std::string labelColorRed = "colorRed";
 std::string labelColorGreen = "colorGreen";
 std::string labelColorBlue = "colorBlue";
+const uint32_t RECORD_PERIOD_MS = 10;
+lib::Logger sensorLog("sensors.bin");
+
+lib::RunLog pickupStats("pickup");
+lib::RunLog placeStats("place");
+lib::RunLog cupStats("cup");
+std::string labelCupsPerMinute = "auto/CUPS_PER_MIN";
+
+const uint32_t BUDGET_PERIOD_MS = 20;
+// Print the budget about once a second rather than every update
+const int BUDGET_TELEMETRY_DIVIDER = 50;
+lib::MotorBudget motorBudget("budget", tuning::MOTOR_BUDGET_TOTAL_AMPS);
+// Added in lib::FrameMotor order so the budget's indices line up with the
+// per-motor readings in each frame
+int leftMotorBudget = motorBudget.addMotor("leftDrive", leftMotor, 
+  tuning::DRIVE_BUDGET_PRIORITY, tuning::DRIVE_HOLD_CURRENT_AMPS);
+int rightMotorBudget = motorBudget.addMotor("rightDrive", rightMotor, 
+  tuning::DRIVE_BUDGET_PRIORITY, tuning::DRIVE_HOLD_CURRENT_AMPS);
+int elevatorMotorBudget = motorBudget.addMotor("elevator", elevatorMotor, 
+  tuning::ELEVATOR_BUDGET_PRIORITY, tuning::ELEVATOR_HOLD_CURRENT_AMPS);
+int intakeMotorBudget = motorBudget.addMotor("intake", intakeMotor, 
+  tuning::INTAKE_BUDGET_PRIORITY, tuning::INTAKE_HOLD_CURRENT_AMPS);
+
+// Reads every device for the control loops and logs the frames they hand
+// back while RECORD_SENSORS is on
+class RobotSensors : public lib::SensorSource {
+public:
+  lib::SensorFrame read() override {
+    lib::SensorFrame frame;
+    frame.timestampMS = vex::timer::system();
+    frame.leftPositionDegrees = leftMotor.position(vex::degrees);
+    frame.rightPositionDegrees = rightMotor.position(vex::degrees);
+    frame.elevatorPositionDegrees = elevatorMotor.position(vex::degrees);
+    frame.intakePositionDegrees = intakeMotor.position(vex::degrees);
+    frame.headingDegrees = inertialSensor.heading();
+    frame.rotationDegrees = inertialSensor.rotation();
+    frame.gyroRateDegPerSec = inertialSensor.gyroRate(vex::zaxis, vex::dps);
+    frame.distanceMM = distanceSensor.objectDistance(vex::mm);
+    frame.batteryVolts = Brain.Battery.voltage(vex::voltageUnits::volt);
+
+    vex::optical::rgbc color = topOpticalSensor.getRgb();
+    frame.opticalRed = color.red;
+    frame.opticalGreen = color.green;
+    frame.opticalBlue = color.blue;
+
+    vex::motor* motors[lib::FRAME_MOTOR_COUNT] = {
+      &leftMotor, &rightMotor, &elevatorMotor, &intakeMotor
+    };
+    for (int i = 0; i < lib::FRAME_MOTOR_COUNT; i++) {
+      frame.motorVelocityRPM[i] = motors[i]->velocity(vex::rpm);
+      frame.motorCurrentAmps[i] = motors[i]->current(vex::currentUnits::amp);
+      frame.motorTemperatureC[i] = 
+        motors[i]->temperature(vex::temperatureUnits::celsius);
+      frame.motorLimitAmps[i] = motorBudget.getLimitAmps(i);
+    }
+
+    frame.limitSwitches = 0;
+    if (upperLimitSwitch.value() == 1) {
+      frame.limitSwitches |= lib::LIMIT_UPPER;
+    }
+    if (lowerLimitSwitch.value() == 1) {
+      frame.limitSwitches |= lib::LIMIT_LOWER;
+    }
+    if (surfaceLimitSwitch.value() == 1) {
+      frame.limitSwitches |= lib::LIMIT_SURFACE;
+    }
+
+    frame.controlMode = lib::CONTROL_NONE;
+    frame.controlRun = 0;
+    frame.setpoint = 0.0f;
+    frame.leftOutput = 0.0f;
+    frame.rightOutput = 0.0f;
+    return frame;
+  }
 
-subsystems::Drive drive(driveName, leftMotor, rightMotor, inertialSensor);
+  void record(const lib::SensorFrame& frame) override {
+    sensorLog.record(frame);
+  }
+};
+
+RobotSensors robotSensors;
+
+// Runs on its own thread so every phase is logged, including blocking
+// elevator and claw moves and smartdrive legs that no loop here reads along
+int recordSensors() {
+  while (true) {
+    robotSensors.record(robotSensors.read());
+    wait(RECORD_PERIOD_MS, vex::msec);
+  }
+  return 0;
+}
+
+subsystems::Drive drive(driveName, leftMotor, rightMotor, inertialSensor,
+  robotSensors);
 subsystems::Elevator elevator(elevatorName, elevatorMotor, 
   upperLimitSwitch, lowerLimitSwitch);
 subsystems::Intake intake(intakeName, intakeMotor, surfaceLimitSwitch);
 
-void prepPickup() {
-  // Claw pre open
-  intake.setPositionRotations(CLAW_OPEN_ROTATIONS, true);
+ColorCentroid toCentroid(const std::array<double, 3>& color) {
+  return {(float) color[0], (float) color[1], (float) color[2], 
+    DEFAULT_COLOR_SPREAD};
+}
 
-  // Elevator to pickup position
-  elevator.setPositionMM(PICKUP_HEIGHT_MM, true);
+RobotConfig defaultRobotConfig() {
+  RobotConfig config;
+  config.colors[ROW_1_GREEN] = toCentroid(COLOR_ROW_1_GREEN);
+  config.colors[ROW_1_BLUE] = toCentroid(COLOR_ROW_1_BLUE);
+  config.colors[ROW_1_PINK] = toCentroid(COLOR_ROW_1_PINK);
+  config.colors[ROW_2_GREEN] = toCentroid(COLOR_ROW_2_GREEN);
+  config.colors[ROW_2_BLUE] = toCentroid(COLOR_ROW_2_BLUE);
+  config.colors[ROW_2_PINK] = toCentroid(COLOR_ROW_2_PINK);
+  config.colors[WHITE] = toCentroid(WHITE_COLOR);
+  config.colors[SINGLE_COLOR] = toCentroid(SINGLE_COLOR_TARGET);
+  return config;
 }
 
-void runPickup() {
-  prepPickup();
+// Catches values that passed the checksum but make no sense on this field
+bool isValidRobotConfig(const RobotConfig& config) {
+  for (const ColorCentroid& color : config.colors) {
+    if (!(color.red >= 0.0f && color.green >= 0.0f && color.blue >= 0.0f
+        && color.spread > 0.0f)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Nothing set, with every slot at the single-cup box
+PipelineTargets defaultPipelineTargets() {
+  PipelineTargets targets;
+  for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+    targets.cups[i] = DEFAULT_CUP_TARGET;
+    targets.slots[i] = {DEFAULT_SLOT_HEADING_DEGREES, 
+      routineSettings.placeCupHeightMM};
+    targets.cupSet[i] = 0;
+    targets.slotSet[i] = 0;
+  }
+  return targets;
+}
+
+std::deque<lib::CupTarget> calibratedCups(const PipelineTargets& targets) {
+  std::deque<lib::CupTarget> cups;
+  for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+    if (targets.cupSet[i]) {
+      cups.push_back(targets.cups[i]);
+    }
+  }
+  return cups;
+}
 
-  // Run until senses cup
-  while (distanceSensor.objectDistance(vex::mm) > PICKUP_DISTANCE_MM) {
-    // TODO Replace with line following logic
-    Brain.Screen.print(distanceSensor.objectDistance(vex::mm));
+std::deque<lib::BoxSlot> calibratedSlots(const PipelineTargets& targets) {
+  std::deque<lib::BoxSlot> slots;
+  for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+    if (targets.slotSet[i]) {
+      slots.push_back(targets.slots[i]);
+    }
+  }
+  return slots;
+}
+
+// Catches values that passed the checksum but make no sense on this field.
+// Each cup is lowered into its slot from the clearance height, and no two
+// slots may put cups in the same spot.
+bool isValidPipelineTargets(const PipelineTargets& targets) {
+  for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+    const lib::CupTarget& cup = targets.cups[i];
+    const lib::BoxSlot& slot = targets.slots[i];
+    if (!(cup.headingDegrees >= 0.0 && cup.headingDegrees <= 360.0
+        && cup.leadInMM >= 0.0 && cup.leadInMM < 4000.0
+        && slot.headingDegrees >= 0.0 && slot.headingDegrees <= 360.0
+        && slot.placeHeightMM >= 0.0 
+        && slot.placeHeightMM < routineSettings.clearTopBoxHeightMM)) {
+      return false;
+    }
+  }
+  return lib::hasDistinctSlots(calibratedSlots(targets));
+}
+
+// Each file falls back to the compiled-in values on its own if the SD card has
+// nothing usable for it. Targets are checked against the routine settings, so
+// they load last. A missing targets file just means none are set yet, so it
+// doesn't count as a failed load.
+bool loadRobotConfig() {
+  RobotConfig loadedConfig;
+  bool colorsLoaded = robotConfigFile.load(&loadedConfig, sizeof(RobotConfig)) 
+    && isValidRobotConfig(loadedConfig);
+  robotConfig = colorsLoaded ? loadedConfig : defaultRobotConfig();
+
+  lib::RoutineSettings loadedSettings;
+  bool settingsLoaded = routineSettingsFile.load(&loadedSettings, 
+      sizeof(lib::RoutineSettings)) 
+    && lib::isValidRoutineSettings(loadedSettings);
+  routineSettings = 
+    settingsLoaded ? loadedSettings : lib::defaultRoutineSettings();
+
+  PipelineTargets loadedTargets;
+  bool targetsLoaded = pipelineTargetsFile.load(&loadedTargets, 
+      sizeof(PipelineTargets)) 
+    && isValidPipelineTargets(loadedTargets);
+  pipelineTargets = targetsLoaded ? loadedTargets : defaultPipelineTargets();
+  return colorsLoaded && settingsLoaded;
+}
+
+// Index of the calibrated color the reading falls within, or -1 for none
+int classifyColor(const vex::optical::rgbc& reading) {
+  int closest = -1;
+  double closestSpreads = COLOR_MATCH_SPREADS;
+  for (int i = 0; i < CALIBRATED_COLOR_COUNT; i++) {
+    const ColorCentroid& color = robotConfig.colors[i];
+    double distance = std::sqrt(
+      std::pow(reading.red - color.red, 2) 
+      + std::pow(reading.green - color.green, 2)
+      + std::pow(reading.blue - color.blue, 2));
+    double spreads = distance / color.spread;
+    if (spreads < closestSpreads) {
+      closest = i;
+      closestSpreads = spreads;
+    }
+  }
+  return closest;
+}
+
+void waitForButtonRelease() {
+  while (pilotController.ButtonA.pressing() || pilotController.ButtonB.pressing()
+      || pilotController.ButtonUp.pressing() 
+      || pilotController.ButtonDown.pressing()) {
+    wait(10, vex::msec);
+  }
+}
+
+// Blocks until the operator presses A (true) or B (false)
+bool waitForChoice() {
+  waitForButtonRelease();
+  while (true) {
+    if (pilotController.ButtonA.pressing()) {
+      return true;
+    }
+    if (pilotController.ButtonB.pressing()) {
+      return false;
+    }
+    wait(10, vex::msec);
+  }
+}
+
+ColorCentroid sampleColor() {
+  std::vector<vex::optical::rgbc> samples;
+  ColorCentroid centroid = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < COLOR_SAMPLES; i++) {
+    vex::optical::rgbc reading = topOpticalSensor.getRgb();
+    samples.push_back(reading);
+    centroid.red += reading.red / COLOR_SAMPLES;
+    centroid.green += reading.green / COLOR_SAMPLES;
+    centroid.blue += reading.blue / COLOR_SAMPLES;
+    wait(10, vex::msec);
+  }
+
+  double sumSquares = 0.0;
+  for (const vex::optical::rgbc& reading : samples) {
+    sumSquares += std::pow(reading.red - centroid.red, 2)
+      + std::pow(reading.green - centroid.green, 2)
+      + std::pow(reading.blue - centroid.blue, 2);
+  }
+  // Keep a floor on the spread so a perfectly steady sensor still matches
+  centroid.spread = std::fmax(std::sqrt(sumSquares / COLOR_SAMPLES), 50.0);
+  return centroid;
+}
+
+// Up/Down nudges the value by step until A accepts it
+double adjustValue(const char* format, const char* name, double value, 
+  double step) {
+  waitForButtonRelease();
+  while (!pilotController.ButtonA.pressing()) {
+    if (pilotController.ButtonUp.pressing()) {
+      value += step;
+      waitForButtonRelease();
+    } else if (pilotController.ButtonDown.pressing()) {
+      value -= step;
+      waitForButtonRelease();
+    }
+
+    Brain.Screen.clearScreen();
+    Brain.Screen.setCursor(1, 1);
+    Brain.Screen.print(format, name, value);
     Brain.Screen.newLine();
+    Brain.Screen.print("Up/Down: adjust  A: accept");
+    wait(20, vex::msec);
+  }
+  return value;
+}
+
+// The operator drives until the robot faces the target. A records the
+// heading, Down clears the target and B leaves it as it was. Returns whether
+// the target is set afterwards.
+bool measureHeading(const char* name, bool set, double& headingDegrees) {
+  waitForButtonRelease();
+  while (true) {
+    if (pilotController.ButtonA.pressing()) {
+      drive.stop();
+      headingDegrees = inertialSensor.heading();
+      return true;
+    }
+    if (pilotController.ButtonDown.pressing()) {
+      drive.stop();
+      return false;
+    }
+    if (pilotController.ButtonB.pressing()) {
+      drive.stop();
+      return set;
+    }
+    drive.arcadeDrive(pilotController.Axis3.value() * CALIBRATION_DRIVE_SCALE, 
+      pilotController.Axis1.value() * CALIBRATION_DRIVE_SCALE);
+
+    Brain.Screen.clearScreen();
     Brain.Screen.setCursor(1, 1);
-    
-    drive.drive(vex::forward, DRIVE_SPEED_PCT, vex::velocityUnits::pct);
+    Brain.Screen.print("Face %s, now %.1f deg", name, inertialSensor.heading());
+    Brain.Screen.newLine();
+    if (set) {
+      Brain.Screen.print("Saved %.1f deg", headingDegrees);
+    } else {
+      Brain.Screen.print("UNSET");
+    }
+    Brain.Screen.newLine();
+    Brain.Screen.print("A: record  B: keep  Down: unset");
+    wait(20, vex::msec);
+  }
+}
+
+void runCalibration() {
+  RobotConfig config = robotConfig;
+
+  for (int i = 0; i < CALIBRATED_COLOR_COUNT; i++) {
+    Brain.Screen.clearScreen();
+    Brain.Screen.setCursor(1, 1);
+    Brain.Screen.print("Hold top sensor over %s", CALIBRATED_COLOR_NAMES[i]);
+    Brain.Screen.newLine();
+    Brain.Screen.print("A: sample  B: keep current");
+    if (waitForChoice()) {
+      config.colors[i] = sampleColor();
+    }
+  }
+
+  struct Setting {
+    const char* name;
+    float* value;
+    double step;
+    const char* format;
+  };
+  lib::RoutineSettings routine = routineSettings;
+  const Setting settings[] = {
+    {"PICKUP DISTANCE", &routine.pickupDistanceMM, DISTANCE_STEP_MM, "%s: %.0f mm"},
+    {"PREP PLACE DISTANCE", &routine.prepPlaceDistanceMM, DISTANCE_STEP_MM, 
+      "%s: %.0f mm"},
+    {"PLACE DISTANCE", &routine.placeDistanceMM, DISTANCE_STEP_MM, "%s: %.0f mm"},
+    {"PICKUP HEIGHT", &routine.pickupHeightMM, DISTANCE_STEP_MM, "%s: %.0f mm"},
+    {"CLEAR BOX HEIGHT", &routine.clearTopBoxHeightMM, DISTANCE_STEP_MM, 
+      "%s: %.0f mm"},
+    {"PLACE HEIGHT", &routine.placeCupHeightMM, DISTANCE_STEP_MM, "%s: %.0f mm"},
+    {"STOW HEIGHT", &routine.stowElevatorMM, DISTANCE_STEP_MM, "%s: %.0f mm"},
+    {"CLAW OPEN", &routine.clawOpenRotations, ROTATION_STEP, "%s: %.2f rev"},
+    {"CLAW CLOSED", &routine.clawClosedRotations, ROTATION_STEP, "%s: %.2f rev"}
+  };
+  for (const Setting& setting : settings) {
+    *setting.value = adjustValue(setting.format, setting.name, 
+      *setting.value, setting.step);
+  }
 
-    wait(5, vex::msec);
+  // Last, since it means driving away from wherever the colors were sampled
+  PipelineTargets targets = pipelineTargets;
+  char name[32];
+  for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+    snprintf(name, sizeof(name), "CUP %d", i + 1);
+    targets.cupSet[i] = measureHeading(name, targets.cupSet[i], 
+      targets.cups[i].headingDegrees);
+    if (targets.cupSet[i]) {
+      snprintf(name, sizeof(name), "CUP %d LEAD-IN", i + 1);
+      targets.cups[i].leadInMM = adjustValue("%s: %.0f mm", name, 
+        targets.cups[i].leadInMM, LEAD_IN_STEP_MM);
+    }
+  }
+  for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+    snprintf(name, sizeof(name), "BOX SLOT %d", i + 1);
+    targets.slotSet[i] = measureHeading(name, targets.slotSet[i], 
+      targets.slots[i].headingDegrees);
+    if (targets.slotSet[i]) {
+      snprintf(name, sizeof(name), "SLOT %d HEIGHT", i + 1);
+      targets.slots[i].placeHeightMM = adjustValue("%s: %.0f mm", name, 
+        targets.slots[i].placeHeightMM, DISTANCE_STEP_MM);
+    }
+  }
+
+  Brain.Screen.clearScreen();
+  Brain.Screen.setCursor(1, 1);
+  if (!isValidRobotConfig(config) || !lib::isValidRoutineSettings(routine)) {
+    Brain.Screen.print("Calibration invalid, not saved");
+    return;
+  }
+  // Checked against the new settings, the slot heights depend on them
+  lib::RoutineSettings previousSettings = routineSettings;
+  routineSettings = routine;
+  if (!isValidPipelineTargets(targets)) {
+    routineSettings = previousSettings;
+    Brain.Screen.print("Box slots overlap or sit too high, not saved");
+    return;
+  }
+  robotConfig = config;
+  pipelineTargets = targets;
+  if (robotConfigFile.save(&robotConfig, sizeof(RobotConfig))
+      && routineSettingsFile.save(&routineSettings, 
+        sizeof(lib::RoutineSettings))
+      && pipelineTargetsFile.save(&pipelineTargets, 
+        sizeof(PipelineTargets))) {
+    Brain.Screen.print("Calibration saved");
+  } else {
+    Brain.Screen.print("No SD card, calibration kept until power off");
   }
-  drive.stop();
+  wait(1, vex::sec);
+}
 
-  // Claw close
-  intake.setPositionRotations(CLAW_CLOSED_ROTATIONS, true);
+// Runs on its own thread so limits keep up no matter what the main loop is
+// blocked on
+int manageMotorBudget() {
+  int iteration = 0;
+  while (true) {
+    motorBudget.periodic();
+    if (iteration % BUDGET_TELEMETRY_DIVIDER == 0) {
+      motorBudget.printTelemetry();
+    }
+    iteration++;
+    wait(BUDGET_PERIOD_MS, vex::msec);
+  }
+  return 0;
+}
 
-  // Elevator to stow cup
-  elevator.setPositionMM(STOW_ELEVATOR_MM, true);
+// Whichever drive side is hotter sets the pace for both
+double driveSpeedScale() {
+  return std::fmin(motorBudget.getSpeedScale(leftMotorBudget), 
+    motorBudget.getSpeedScale(rightMotorBudget));
 }
 
-void runAutoPlace() {
-    // Drive to prep placing position
-  while (distanceSensor.objectDistance(vex::mm) > PREP_PLACE_DISTANCE_MM) {
-    drive.drive(vex::forward, DRIVE_SPEED_PCT, vex::velocityUnits::pct);
+// Hands the shared routines the robot's subsystems
+class RobotDevices : public lib::RoutineRobot {
+public:
+  void driveDistance(double distanceMM, bool blocking) override {
+    drive.driveDistance(distanceMM < 0.0 ? vex::reverse : vex::forward, 
+      std::fabs(distanceMM), vex::mm, blocking);
+  }
 
-    wait(5, vex::msec);
+  void turnToAngle(double angleDegrees) override {
+    drive.turnToAngle(angleDegrees < 0.0 ? vex::left : vex::right, 
+      std::fabs(angleDegrees), vex::degrees, true);
   }
-  drive.stop();
 
-  // Elevator raised to clearence
-  elevator.setPositionMM(CLEAR_TOP_BOX_HEIGHT_MM, true);
+  void turnToHeading(double headingDegrees) override {
+    drive.turnToHeading(headingDegrees);
+  }
 
-  // Drive to place position
-  drive.driveDistance(vex::forward, PREP_PLACE_DISTANCE_MM - PLACE_DISTANCE_MM, 
-    vex::mm, false);
+  void spinInPlace(double degreesPerSec) override {
+    drive.spinInPlace(degreesPerSec);
+  }
 
-  // Elevator lower to place
-  elevator.setPositionMM(PLACE_CUP_HEIGHT_MM, true);
+  void drivePct(double speedPct) override {
+    drive.drive(vex::forward, speedPct * driveSpeedScale(), 
+      vex::velocityUnits::pct);
+  }
 
-  // Claw open
-  intake.setPositionRotations(CLAW_OPEN_ROTATIONS, true);
+  void stopDrive() override {
+    drive.stop();
+  }
 
-  // Elevator raise to clearence
-  elevator.setPositionMM(CLEAR_TOP_BOX_HEIGHT_MM, true);
+  void setElevatorMM(double heightMM, bool blocking) override {
+    elevator.setPositionMM(heightMM, blocking);
+  }
 
-  // Claw close
-  intake.setPositionRotations(CLAW_CLOSED_ROTATIONS, true);
+  void setClawRotations(double rotations, bool blocking) override {
+    intake.setPositionRotations(rotations, blocking);
+  }
 
-  // Drive backwards
-  drive.driveDistance(vex::reverse, PREP_PLACE_DISTANCE_MM, vex::mm, false);
+  void wait(double ms) override {
+    vex::wait(ms, vex::msec);
+  }
 
-  // Elevator lower to pickup
-  elevator.setPositionMM(PICKUP_HEIGHT_MM, true);
-}
+  double timeMS() override {
+    return vex::timer::system();
+  }
 
-int main() {
-  // Initialization routine for devices that need it
-  Brain.Screen.print("Device initialization...");
-  Brain.Screen.setCursor(2, 1);
-  // calibrate the drivetrain inertial
-  wait(200, msec);
+  void recordRun(lib::RoutineRun run, double durationMS, 
+    bool success) override {
+    switch (run) {
+      case lib::RUN_PICKUP:
+        pickupStats.record(durationMS, success);
+        break;
+      case lib::RUN_PLACE:
+        placeStats.record(durationMS, success);
+        break;
+      case lib::RUN_CUP:
+        cupStats.record(durationMS, success);
+        break;
+    }
+  }
+};
+
+RobotDevices robotDevices;
+lib::Routines routines(robotSensors, robotDevices, routineSettings, 
+  lib::defaultRoutineGains());
+
+// Startup tasks, each run on its own thread by lib::Startup. Anything that has
+// to happen in a set order belongs inside a single task, or after the task it
+// waits on.
+bool calibrateInertial() {
+  // Give the sensor a moment after power-on, or after the mechanisms stop,
+  // before calibrating
+  wait(200, vex::msec);
   inertialSensor.startCalibration(1);
-  Brain.Screen.print("Calibrating Gyro for Drivetrain");
-  // wait for the inertial calibration process to finish
   while (inertialSensor.isCalibrating()) {
-    wait(25, msec);
+    wait(25, vex::msec);
   }
-  // reset the screen now that the calibration is complete
-  Brain.Screen.clearScreen();
-  Brain.Screen.setCursor(1, 1);
-  wait(50, msec);
-  Brain.Screen.clearScreen();
-  // Turn on color sensor light
+  return true;
+}
+
+bool warmUpOpticalLights() {
   topOpticalSensor.setLight(vex::ledState::on);
   leftOpticalSensor.setLight(vex::ledState::on);
   rightOpticalSensor.setLight(vex::ledState::on);
+  // Readings drift for a little while after the LEDs come on
+  wait(OPTICAL_WARM_UP_MS, vex::msec);
+  return true;
+}
 
-  if (RUN_AUTONOMOUS) {
-    if (RUN_MAIN_AUTO) {
-      // Grab constants based on where the robot is running
-      double initialDistanceMM = 0.0;
-      std::array<double, 3> colorToSeek;
+bool homeElevator() {
+  return elevator.home();
+}
 
-      initialDistanceMM = SINGLE_COLOR_DISTANCE_MM;
-      colorToSeek = SINGLE_COLOR_TARGET;
+bool zeroClaw() {
+  return intake.zero(CLAW_ZEROING_TIMEOUT_MS);
+}
 
-      // Raise claw to be out of way
-      elevator.setPositionMM(STOW_ELEVATOR_MM, true);
+bool loadConfig() {
+  // Without saved gains the drive falls back to smartdrive
+  drive.loadCharacterization();
+  // Earlier sessions' runs, so the percentiles keep building up
+  pickupStats.load();
+  placeStats.load();
+  cupStats.load();
+  return loadRobotConfig();
+}
 
-      // Drive until on side of color row
-      drive.driveDistance(vex::forward, 4800.0, vex::mm, true);
+int main() {
+  // Started first so startup gets logged as well. Lives as long as the
+  // program.
+  if (RECORD_SENSORS) {
+    sensorLog.startRecording();
+    static vex::thread sensorRecorder(recordSensors);
+  }
 
-      // Turn left 90 deg
-      drive.turnToAngle(vex::left, 90.0, vex::degrees, true);
+  // Initialization routine for devices that need it. Homing needs the limit
+  // switch callbacks, so they go in first.
+  elevator.registerLimitCallbacks();
+  // In place before anything can read it, in case loading the config fails
+  robotConfig = defaultRobotConfig();
+  routineSettings = lib::defaultRoutineSettings();
+  pipelineTargets = defaultPipelineTargets();
+  Brain.Screen.print("Device initialization...");
 
-      // Drive until on correct pad
-      drive.driveDistance(vex::forward, 4600.0, vex::mm, true);
+  // Homing can run the carriage down its whole travel and stop it hard on
+  // the switch, which would shake the calibration, so the inertial sensor
+  // waits until the elevator and claw are done. Startup takes as long as
+  // homing and calibration back to back.
+  lib::Startup startup("startup");
+  int homing = startup.addTask("elevator", homeElevator, 
+    elevator.getHomingTimeoutMS() + 500.0);
+  int zeroing = startup.addTask("claw", zeroClaw, 
+    CLAW_ZEROING_TIMEOUT_MS + 500.0);
+  startup.addTask("inertial", calibrateInertial, 
+    200.0 + INERTIAL_CALIBRATION_TIMEOUT_MS, {homing, zeroing});
+  startup.addTask("optical", warmUpOpticalLights, 500.0);
+  startup.addTask("config", loadConfig, 1000.0);
+  bool ready = startup.run();
+  startup.printTelemetry();
 
-      // Turn left 90 deg
-      drive.turnToAngle(vex::left, 90.0, vex::degrees, true);
+  Brain.Screen.clearScreen();
+  Brain.Screen.setCursor(1, 1);
+  if (!ready) {
+    // Still safe to run, failed tasks fall back to their defaults
+    Brain.Screen.print("Startup incomplete, see telemetry");
+    Brain.Screen.newLine();
+  }
 
-      // Run to pickup the cup
-      runPickup();
+  if (RUN_DRIVE_CHARACTERIZATION) {
+    if (!drive.characterize()) {
+      Brain.Screen.print("Drive characterization failed");
+    }
+    sensorLog.flush();
+    return 0;
+  }
 
-      // Turn left 90 deg
-      drive.turnToAngle(vex::left, 90.0, vex::degrees, true);
+  // Started after characterization so current limits don't skew the fit
+  vex::thread budgetManager(manageMotorBudget);
 
-      // Score cup
-      runAutoPlace();
+  if (RUN_AUTONOMOUS) {
+    if (RUN_MAIN_AUTO) {
+      std::deque<lib::CupTarget> cups = calibratedCups(pipelineTargets);
+      std::deque<lib::BoxSlot> slots = calibratedSlots(pipelineTargets);
+      if (!RUN_MULTI_CUP_AUTO) {
+        routines.runMainAuto();
+      } else if (cups.empty() || slots.empty()) {
+        Brain.Screen.print("No cups or box slots set, calibrate them first");
+      } else if (!lib::hasDistinctSlots(slots)) {
+        Brain.Screen.print("Box slots overlap, calibrate them again");
+      } else {
+        routines.driveToCups();
+        double cupsPerMinute = routines.runCupPipeline(cups, slots);
+        lib::Telemetry::writeOutput(labelCupsPerMinute, cupsPerMinute);
+        cupStats.printTelemetry();
+      }
     } else {
       // Prep Open claw
-      intake.setPositionRotations(CLAW_OPEN_ROTATIONS, true);
+      intake.setPositionRotations(routineSettings.clawOpenRotations, true);
 
       // Drive until cup is in front of distance sensor
-      while (distanceSensor.objectDistance(vex::mm) > PICKUP_DISTANCE_MM) {
-        drive.drive(vex::forward, DRIVE_SPEED_PCT, vex::velocityUnits::pct);
+      while (distanceSensor.objectDistance(vex::mm) > 
+        routineSettings.pickupDistanceMM) {
+        drive.drive(vex::forward, tuning::DRIVE_SPEED_PCT, vex::velocityUnits::pct);
       }
       drive.stop();
       wait(1, vex::sec);
   
       // Close claw
-      intake.setPositionRotations(CLAW_CLOSED_ROTATIONS, true);
+      intake.setPositionRotations(routineSettings.clawClosedRotations, true);
   
       // Stow elevator to clear distance sensor
-      elevator.setPositionMM(STOW_ELEVATOR_MM, true);
+      elevator.setPositionMM(routineSettings.stowElevatorMM, true);
   
       // Turn to boxes
       drive.turnToAngle(vex::right, 90.0, vex::degrees, true);
   
       // Drive until stack of boxes is in front of robot
-      while (distanceSensor.objectDistance(vex::mm) > PREP_PLACE_DISTANCE_MM) {
-        drive.drive(vex::forward, DRIVE_SPEED_PCT, vex::velocityUnits::pct);
+      while (distanceSensor.objectDistance(vex::mm) > 
+        routineSettings.prepPlaceDistanceMM) {
+        drive.drive(vex::forward, tuning::DRIVE_SPEED_PCT, vex::velocityUnits::pct);
   
         wait(5, vex::msec);
       }
       drive.stop();
   
       // Lift elevator to clearence level
-      elevator.setPositionMM(CLEAR_TOP_BOX_HEIGHT_MM, true);
+      elevator.setPositionMM(routineSettings.clearTopBoxHeightMM, true);
   
       // Drive forward slightly
-      drive.driveDistance(vex::forward, PREP_PLACE_DISTANCE_MM - PLACE_DISTANCE_MM, 
-        vex::mm, true);
+      drive.driveDistance(vex::forward, routineSettings.prepPlaceDistanceMM 
+        - routineSettings.placeDistanceMM, vex::mm, true);
   
       // Lower elevator into box
-      elevator.setPositionMM(PLACE_CUP_HEIGHT_MM, true);
+      elevator.setPositionMM(routineSettings.placeCupHeightMM, true);
   
       // Drop cup
-      intake.setPositionRotations(CLAW_OPEN_ROTATIONS, true);
+      intake.setPositionRotations(routineSettings.clawOpenRotations, true);
   
       // Back out from cup
-      elevator.setPositionMM(CLEAR_TOP_BOX_HEIGHT_MM, true);
+      elevator.setPositionMM(routineSettings.clearTopBoxHeightMM, true);
   
       // Close claw
-      intake.setPositionRotations(CLAW_CLOSED_ROTATIONS, true);
+      intake.setPositionRotations(routineSettings.clawClosedRotations, true);
   
       // Drive backward slightly
-      drive.driveDistance(vex::reverse, PREP_PLACE_DISTANCE_MM, vex::mm, true);
+      drive.driveDistance(vex::reverse, routineSettings.prepPlaceDistanceMM, 
+        vex::mm, true);
   
       // Lower elevator to pickup position
-      elevator.setPositionMM(PICKUP_HEIGHT_MM, true);
+      elevator.setPositionMM(routineSettings.pickupHeightMM, true);
     }
+
+    pickupStats.printTelemetry();
+    placeStats.printTelemetry();
+
+    // Autonomous ends the program, so write out the tail of the log
+    sensorLog.flush();
   } else {
     if (RUN_CALIBRATION_MODE) {
+      runCalibration();
+
+      // Live readout afterwards to check the new calibration
+      std::string labelMatchedColor = "matchedColor";
       while (true) {
         elevator.printTelemetry();
         intake.printTelemetry();
@@ -278,6 +861,8 @@ int main() {
         lib::Telemetry::writeOutput(labelColorRed, topOpticalSensor.getRgb().red);
         lib::Telemetry::writeOutput(labelColorGreen, topOpticalSensor.getRgb().green);
         lib::Telemetry::writeOutput(labelColorBlue, topOpticalSensor.getRgb().blue);
+        int matchedColor = classifyColor(topOpticalSensor.getRgb());
+        lib::Telemetry::writeOutput(labelMatchedColor, matchedColor);
 
         Brain.Screen.print(topOpticalSensor.getRgb().red);
         Brain.Screen.newLine();
@@ -287,6 +872,27 @@ int main() {
         Brain.Screen.newLine();
         Brain.Screen.print(distanceSensor.objectDistance(vex::mm));
         Brain.Screen.newLine();
+        Brain.Screen.print(matchedColor >= 0 
+          ? CALIBRATED_COLOR_NAMES[matchedColor] : "NO MATCH");
+        Brain.Screen.newLine();
+        // The multi-cup auto skips anything still UNSET
+        for (int i = 0; i < PIPELINE_TARGET_COUNT; i++) {
+          if (pipelineTargets.cupSet[i]) {
+            Brain.Screen.print("CUP %d: %.1f deg +%.0f mm  ", i + 1, 
+              pipelineTargets.cups[i].headingDegrees, 
+              pipelineTargets.cups[i].leadInMM);
+          } else {
+            Brain.Screen.print("CUP %d: UNSET              ", i + 1);
+          }
+          if (pipelineTargets.slotSet[i]) {
+            Brain.Screen.print("SLOT %d: %.1f deg %.0f mm", i + 1, 
+              pipelineTargets.slots[i].headingDegrees, 
+              pipelineTargets.slots[i].placeHeightMM);
+          } else {
+            Brain.Screen.print("SLOT %d: UNSET           ", i + 1);
+          }
+          Brain.Screen.newLine();
+        }
         Brain.Screen.setCursor(1, 1);
 
         wait(5, vex::msec);
@@ -294,33 +900,38 @@ int main() {
     } else {
       while (true) {
         if (pilotController.ButtonY.pressing()) {
-          runAutoPlace();
+          // Teleop stops the elevator whenever X and B are released, so the
+          // lowering has to be finished before handing control back
+          routines.runAutoPlace(routineSettings.placeCupHeightMM, true);
+          placeStats.printTelemetry();
         } else if (pilotController.ButtonA.pressing()) {
-          runPickup();
+          routines.runPickup(false);
+          pickupStats.printTelemetry();
         } else {
           if (pilotController.ButtonLeft.PRESSED) {
             drive.turnToAngle(vex::left, 90.0, vex::degrees, true);
           } else if (pilotController.ButtonRight.PRESSED) {
             drive.turnToAngle(vex::right, 90.0, vex::degrees, true);
           } else {
-            drive.arcadeDrive(
-              pilotController.Axis3.value() * 0.75, pilotController.Axis1.value() * 0.75);
+            double speedScale = 0.75 * driveSpeedScale();
+            drive.arcadeDrive(pilotController.Axis3.value() * speedScale, 
+              pilotController.Axis1.value() * speedScale);
           }
 
           // Claw bindings
           if (pilotController.ButtonL1.pressing()) {
-            intake.setPositionRotations(CLAW_OPEN_ROTATIONS, false);
+            intake.setPositionRotations(routineSettings.clawOpenRotations, false);
           } else if (pilotController.ButtonR1.pressing()) {
-            intake.setPositionRotations(CLAW_CLOSED_ROTATIONS, false);
+            intake.setPositionRotations(routineSettings.clawClosedRotations, false);
           } else {
             intake.stop();
           }
 
           // Elevator bindings
           if (pilotController.ButtonX.pressing()) {
-            elevator.setPositionMM(CLEAR_TOP_BOX_HEIGHT_MM, false);
+            elevator.setPositionMM(routineSettings.clearTopBoxHeightMM, false);
           } else if (pilotController.ButtonB.pressing()) {
-            elevator.setPositionMM(PICKUP_HEIGHT_MM, false);
+            elevator.setPositionMM(routineSettings.pickupHeightMM, false);
           } else {
             elevator.stop();
           }
@@ -8,27 +8,51 @@
 
 #include "subsystems/drive.h"
 #include "lib/telemetry.h"
+#include "lib/motion.h"
+#include "tuning.h"
+#include <vector>
 
 namespace subsystems {
+  // Block saved through lib::ConfigFile
+  struct CharacterizationGains {
+    double left[3];
+    double right[3];
+  };
+
   Drive::Drive(
     std::string& name,
     vex::motor& leftMotorReference, 
     vex::motor& rightMotorReference, 
-    vex::inertial& inertialSensorReference
+    vex::inertial& inertialSensorReference,
+    lib::SensorSource& sensorSourceReference
   )
   : lib::Subsystem(name),
     leftMotor(leftMotorReference),
     rightMotor(rightMotorReference),
     inertialSensor(inertialSensorReference),
+    sensorSource(sensorSourceReference),
     robotDrive(leftMotor, rightMotor, inertialSensor, 
                WHEEL_CIRCUMFERENCE, TRACK_WIDTH, WHEEL_BASE, 
-               UNITS, EXTERNAL_GEAR_RATIO) {}
+               UNITS, EXTERNAL_GEAR_RATIO),
+    leftFeedforward(0.0, NOMINAL_BATTERY_VOLTS / FREE_SPEED_MM_PER_SEC, 0.0),
+    rightFeedforward(0.0, NOMINAL_BATTERY_VOLTS / FREE_SPEED_MM_PER_SEC, 0.0),
+    characterized(false),
+    characterizationFile(CHARACTERIZATION_FILE, CHARACTERIZATION_VERSION) {}
 
   void Drive::periodic() {
     printTelemetry();
   }
 
-  void Drive::printTelemetry() {}
+  void Drive::printTelemetry() {
+    lib::Telemetry::writeOutput(labelLeftVelocity, getVelocityMMPerSec(leftMotor));
+    lib::Telemetry::writeOutput(labelRightVelocity, getVelocityMMPerSec(rightMotor));
+    lib::Telemetry::writeOutput(labelLeftKS, leftFeedforward.kS);
+    lib::Telemetry::writeOutput(labelLeftKV, leftFeedforward.kV);
+    lib::Telemetry::writeOutput(labelLeftKA, leftFeedforward.kA);
+    lib::Telemetry::writeOutput(labelRightKS, rightFeedforward.kS);
+    lib::Telemetry::writeOutput(labelRightKV, rightFeedforward.kV);
+    lib::Telemetry::writeOutput(labelRightKA, rightFeedforward.kA);
+  }
 
   void Drive::stop() {
     leftMotor.stop();
@@ -46,7 +70,15 @@ namespace subsystems {
 
   void Drive::driveDistance(vex::directionType direction, double distance, 
     vex::distanceUnits units, bool blocking) {
-    robotDrive.setDriveVelocity(30.0, vex::pct);
+    // The profiled drive only runs in the calling thread, so non-blocking
+    // moves are still handed off to smartdrive
+    if (characterized && blocking) {
+      double distanceMM = toMM(distance, units);
+      driveProfiledMM(direction == vex::reverse ? -distanceMM : distanceMM);
+      return;
+    }
+
+    robotDrive.setDriveVelocity(tuning::DRIVE_DISTANCE_SPEED_PCT, vex::pct);
     robotDrive.driveFor(direction, distance, units, blocking);
   }
 
@@ -54,10 +86,273 @@ namespace subsystems {
     vex::turnType direction, double angle,
     vex::rotationUnits units, bool blocking) 
   {
-    robotDrive.turnFor(direction, angle, units, blocking);
+    // Same as driveDistance(), only blocking turns run the profiled loop.
+    // Without a characterized kS the loop can't overcome static friction
+    // near the end of a turn, so it falls back to smartdrive as well.
+    if (!characterized || !blocking) {
+      robotDrive.turnFor(direction, angle, units, blocking);
+      return;
+    }
+
+    double angleDegrees = units == vex::rev ? angle * 360.0 : angle;
+    turnProfiledDegrees(direction == vex::left ? -angleDegrees : angleDegrees);
+  }
+
+  void Drive::turnToHeading(double headingDegrees) {
+    // Wrap the difference into [-180, 180) so the turn never goes the long way
+    double error = std::fmod(headingDegrees - getHeadingDegrees(), 360.0);
+    if (error >= 180.0) {
+      error -= 360.0;
+    } else if (error < -180.0) {
+      error += 360.0;
+    }
+
+    if (!characterized) {
+      robotDrive.turnFor(error < 0.0 ? vex::left : vex::right, 
+        std::fabs(error), vex::degrees, true);
+      return;
+    }
+    turnProfiledDegrees(error);
+  }
+
+  void Drive::spinInPlace(double degreesPerSec) {
+    double wheelVelocity = degreesPerSec * MM_PER_DEGREE;
+    // Uncharacterized feedforward has no kS, so a slow spin may never start
+    if (!characterized) {
+      double wheelRPM = std::fabs(wheelVelocity) / WHEEL_CIRCUMFERENCE * 60.0
+        * EXTERNAL_GEAR_RATIO;
+      robotDrive.turn(degreesPerSec < 0.0 ? vex::left : vex::right, 
+        wheelRPM, vex::rpm);
+      return;
+    }
+    setVelocityMMPerSec(wheelVelocity, -wheelVelocity, 0.0, 0.0);
+  }
+
+  void Drive::setVelocityMMPerSec(double leftVelocity, double rightVelocity,
+    double leftAcceleration, double rightAcceleration) {
+    setVelocityMMPerSec(leftVelocity, rightVelocity, 
+      leftAcceleration, rightAcceleration,
+      getVelocityMMPerSec(leftMotor), getVelocityMMPerSec(rightMotor));
+  }
+
+  void Drive::setVelocityMMPerSec(double leftVelocity, double rightVelocity,
+    double leftAcceleration, double rightAcceleration,
+    double measuredLeftVelocity, double measuredRightVelocity) {
+    double leftVolts = leftFeedforward.calculate(leftVelocity, leftAcceleration)
+      + tuning::DRIVE_VELOCITY_KP * (leftVelocity - measuredLeftVelocity);
+    double rightVolts = rightFeedforward.calculate(rightVelocity, rightAcceleration)
+      + tuning::DRIVE_VELOCITY_KP * (rightVelocity - measuredRightVelocity);
+
+    setVoltage(leftVolts, rightVolts);
+  }
+
+  bool Drive::characterize() {
+    std::vector<lib::FeedforwardSample> leftQuasistatic;
+    std::vector<lib::FeedforwardSample> rightQuasistatic;
+    std::vector<lib::FeedforwardSample> leftStep;
+    std::vector<lib::FeedforwardSample> rightStep;
+
+    // Voltages are recorded as what they would be on a nominal battery, since
+    // that is what setVoltage() compensates back to
+    vex::timer timer;
+    double rampDurationMS = 
+      QUASISTATIC_MAX_VOLTS / QUASISTATIC_RAMP_VOLTS_PER_SEC * 1000.0;
+    while (timer.time(vex::msec) < rampDurationMS) {
+      double volts = 
+        timer.time(vex::msec) / 1000.0 * QUASISTATIC_RAMP_VOLTS_PER_SEC;
+      setVoltage(volts, volts);
+
+      leftQuasistatic.push_back({volts, getVelocityMMPerSec(leftMotor), 0.0});
+      rightQuasistatic.push_back({volts, getVelocityMMPerSec(rightMotor), 0.0});
+
+      wait(CONTROL_PERIOD_MS, vex::msec);
+    }
+    stop();
+    wait(1, vex::sec);
+
+    // Step backward so the robot ends up roughly where it started
+    double lastLeftVelocity = getVelocityMMPerSec(leftMotor);
+    double lastRightVelocity = getVelocityMMPerSec(rightMotor);
+    double lastTimeMS = 0.0;
+    timer.clear();
+    while (timer.time(vex::msec) < STEP_DURATION_MS) {
+      setVoltage(-STEP_VOLTS, -STEP_VOLTS);
+      wait(CONTROL_PERIOD_MS, vex::msec);
+
+      double nowMS = timer.time(vex::msec);
+      double dt = (nowMS - lastTimeMS) / 1000.0;
+      double leftVelocity = getVelocityMMPerSec(leftMotor);
+      double rightVelocity = getVelocityMMPerSec(rightMotor);
+      if (dt > 0.0) {
+        leftStep.push_back({-STEP_VOLTS, leftVelocity, 
+          (leftVelocity - lastLeftVelocity) / dt});
+        rightStep.push_back({-STEP_VOLTS, rightVelocity, 
+          (rightVelocity - lastRightVelocity) / dt});
+      }
+
+      lastLeftVelocity = leftVelocity;
+      lastRightVelocity = rightVelocity;
+      lastTimeMS = nowMS;
+    }
+    stop();
+
+    if (!lib::Feedforward::fit(leftQuasistatic, leftStep, leftFeedforward)
+        || !lib::Feedforward::fit(rightQuasistatic, rightStep, rightFeedforward)) {
+      return false;
+    }
+    characterized = true;
+    printTelemetry();
+
+    // Gains are still good for this run even if there is no SD card
+    saveCharacterization();
+    return true;
+  }
+
+  bool Drive::loadCharacterization() {
+    CharacterizationGains gains;
+    if (characterizationFile.load(&gains, sizeof(CharacterizationGains))) {
+      leftFeedforward = lib::Feedforward(gains.left[0], gains.left[1], gains.left[2]);
+      rightFeedforward = lib::Feedforward(gains.right[0], gains.right[1], gains.right[2]);
+      characterized = true;
+      return true;
+    }
+    return false;
+  }
+
+  void Drive::saveCharacterization() {
+    CharacterizationGains gains = {
+      {leftFeedforward.kS, leftFeedforward.kV, leftFeedforward.kA},
+      {rightFeedforward.kS, rightFeedforward.kV, rightFeedforward.kA}
+    };
+    characterizationFile.save(&gains, sizeof(CharacterizationGains));
+  }
+
+  bool Drive::isCharacterized() {
+    return characterized;
   }
 
   double Drive::getHeadingDegrees() { 
     return inertialSensor.heading(); 
   }
-}
\ No newline at end of file
+
+  double Drive::getRotationDegrees() {
+    return inertialSensor.rotation();
+  }
+
+  void Drive::driveProfiledMM(double distanceMM) {
+    lib::ProfiledDrive controller(distanceMM, lib::defaultDriveGains());
+    uint16_t run = sensorSource.startControlRun();
+    lib::SensorFrame start = sensorSource.read();
+    start.controlMode = lib::CONTROL_DRIVE;
+    start.controlRun = run;
+    start.setpoint = distanceMM;
+    sensorSource.record(start);
+
+    while (true) {
+      lib::SensorFrame frame = sensorSource.read();
+      double t = (frame.timestampMS - start.timestampMS) / 1000.0;
+      lib::DriveCommand command = controller.calculate(t, 
+        degreesToMM(frame.leftPositionDegrees - start.leftPositionDegrees),
+        degreesToMM(frame.rightPositionDegrees - start.rightPositionDegrees));
+
+      frame.controlMode = lib::CONTROL_DRIVE;
+      frame.controlRun = run;
+      frame.setpoint = distanceMM;
+      frame.leftOutput = command.done ? 0.0 : command.leftVelocityMMPerSec;
+      frame.rightOutput = command.done ? 0.0 : command.rightVelocityMMPerSec;
+      sensorSource.record(frame);
+      if (command.done) {
+        break;
+      }
+
+      setVelocityMMPerSec(
+        command.leftVelocityMMPerSec, command.rightVelocityMMPerSec,
+        command.accelerationMMPerSec2, command.accelerationMMPerSec2,
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_LEFT_DRIVE]),
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_RIGHT_DRIVE]));
+
+      wait(CONTROL_PERIOD_MS, vex::msec);
+    }
+    stop();
+  }
+
+  void Drive::turnProfiledDegrees(double angleDegrees) {
+    lib::ProfiledTurn controller(angleDegrees, lib::defaultTurnGains());
+    uint16_t run = sensorSource.startControlRun();
+    // rotation() doesn't wrap at 360, so there is no wraparound to handle here
+    lib::SensorFrame start = sensorSource.read();
+    start.controlMode = lib::CONTROL_TURN;
+    start.controlRun = run;
+    start.setpoint = angleDegrees;
+    sensorSource.record(start);
+
+    while (true) {
+      lib::SensorFrame frame = sensorSource.read();
+      double t = (frame.timestampMS - start.timestampMS) / 1000.0;
+      lib::TurnCommand command = controller.calculate(t,
+        frame.rotationDegrees - start.rotationDegrees, 
+        frame.gyroRateDegPerSec);
+
+      double wheelVelocity = command.velocityDegPerSec * MM_PER_DEGREE;
+      double wheelAcceleration = command.accelerationDegPerSec2 * MM_PER_DEGREE;
+      frame.controlMode = lib::CONTROL_TURN;
+      frame.controlRun = run;
+      frame.setpoint = angleDegrees;
+      frame.leftOutput = command.done ? 0.0 : wheelVelocity;
+      frame.rightOutput = command.done ? 0.0 : -wheelVelocity;
+      sensorSource.record(frame);
+      if (command.done) {
+        break;
+      }
+
+      setVelocityMMPerSec(wheelVelocity, -wheelVelocity, 
+        wheelAcceleration, -wheelAcceleration,
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_LEFT_DRIVE]),
+        rpmToMMPerSec(frame.motorVelocityRPM[lib::MOTOR_RIGHT_DRIVE]));
+
+      wait(CONTROL_PERIOD_MS, vex::msec);
+    }
+    stop();
+  }
+
+  void Drive::setVoltage(double leftVolts, double rightVolts) {
+    double scale = batteryScale();
+    leftVolts = std::fmax(-MAX_VOLTS, std::fmin(MAX_VOLTS, leftVolts * scale));
+    rightVolts = std::fmax(-MAX_VOLTS, std::fmin(MAX_VOLTS, rightVolts * scale));
+
+    leftMotor.spin(vex::forward, leftVolts, vex::volt);
+    rightMotor.spin(vex::forward, rightVolts, vex::volt);
+  }
+
+  double Drive::getVelocityMMPerSec(vex::motor& motor) {
+    return rpmToMMPerSec(motor.velocity(vex::rpm));
+  }
+
+  double Drive::degreesToMM(double motorDegrees) {
+    return motorDegrees / 360.0 / EXTERNAL_GEAR_RATIO * WHEEL_CIRCUMFERENCE;
+  }
+
+  double Drive::rpmToMMPerSec(double motorRPM) {
+    return motorRPM / 60.0 / EXTERNAL_GEAR_RATIO * WHEEL_CIRCUMFERENCE;
+  }
+
+  // Scales a voltage fit on a nominal battery to the battery we actually have
+  double Drive::batteryScale() {
+    double batteryVolts = Brain.Battery.voltage(vex::voltageUnits::volt);
+    if (batteryVolts <= 0.0) {
+      return 1.0;
+    }
+    return NOMINAL_BATTERY_VOLTS / batteryVolts;
+  }
+
+  double Drive::toMM(double distance, vex::distanceUnits units) {
+    switch (units) {
+      case vex::inches:
+        return distance * 25.4;
+      case vex::cm:
+        return distance * 10.0;
+      default:
+        return distance;
+    }
+  }
+}
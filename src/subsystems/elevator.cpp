@@ -10,16 +10,21 @@
 #include "lib/telemetry.h"
 
 namespace subsystems {
+  Elevator* Elevator::instance = nullptr;
+
   Elevator::Elevator(
     std::string& name,
     vex::motor& motorReference,
-    vex::digital_in& limitSwitchUpperReference,
-    vex::digital_in& limitSwitchLowerReference
+    vex::limit& limitSwitchUpperReference,
+    vex::limit& limitSwitchLowerReference
   )
   : lib::Subsystem(name),
     motor(motorReference),
     limitSwitchUpper(limitSwitchUpperReference),
     limitSwitchLower(limitSwitchLowerReference),
+    upperFault(false),
+    lowerFault(false),
+    homed(false),
     heightSetpointMM(0.0) {}
 
   void Elevator::periodic() {
@@ -31,6 +36,9 @@ namespace subsystems {
     lib::Telemetry::writeOutput(Elevator::labelAtTarget, atTarget());
     lib::Telemetry::writeOutput(Elevator::labelAtUpper, atUpperBound());
     lib::Telemetry::writeOutput(Elevator::labelAtLower, atLowerBound());
+    lib::Telemetry::writeOutput(Elevator::labelUpperFault, (bool) upperFault);
+    lib::Telemetry::writeOutput(Elevator::labelLowerFault, (bool) lowerFault);
+    lib::Telemetry::writeOutput(Elevator::labelHomed, (bool) homed);
   }
 
   void Elevator::stop() {
@@ -40,40 +48,120 @@ namespace subsystems {
   void Elevator::setPositionMM(double targetHeightMM, bool blocking) {
     heightSetpointMM = targetHeightMM;
 
-    // if (atUpperBound() && motor.direction() == vex::forward) {
-    //   stop();
-    // } else if (atLowerBound() && motor.direction() == vex::reverse) {
-    //   stop();
-    // } else {
-    //   double rotationSetpointDegrees = mmToDegrees(heightSetpointMM);
-
-    //   // NOTE the robot program will cease until this action is completed,
-    //   // may need to remove later if blocking becomes an issue
-    //   motor.spinToPosition(rotationSetpointDegrees, vex::degrees, true);
-    // }
+    if (!allowMove(heightSetpointMM > getPositionMM())) {
+      stop();
+      return;
+    }
     double rotationSetpointDegrees = mmToDegrees(heightSetpointMM);
-
-    // NOTE the robot program will cease until this action is completed,
-    // may need to remove later if blocking becomes an issue
-    motor.spinToPosition(rotationSetpointDegrees, vex::degrees, blocking);
+    motor.spinToPosition(rotationSetpointDegrees, vex::degrees, false);
+
+    // A blocking move hands back once the carriage is within tolerance rather
+    // than waiting out the motor's own settling. The motor keeps holding the
+    // setpoint either way, and a limit switch stopping it ends the wait too.
+    // isDone() is only checked after a tick, once the motor has had a chance
+    // to start moving.
+    while (blocking && !atTarget()) {
+      wait(10, vex::msec);
+      if (motor.isDone()) {
+        break;
+      }
+    }
   }
 
   void Elevator::setVoltage(vex::directionType direction, double voltage) {
-    if (atUpperBound() && motor.direction() == vex::forward) {
-      stop();
-    } else if (atLowerBound() && motor.direction() == vex::reverse) {
+    bool movingUp = (direction == vex::forward) == (voltage >= 0.0);
+    if (!allowMove(movingUp)) {
       stop();
     } else {
       motor.spin(direction, voltage, vex::volt);
     }
   }
 
+  void Elevator::registerLimitCallbacks() {
+    instance = this;
+    limitSwitchUpper.pressed(onUpperPressed);
+    limitSwitchLower.pressed(onLowerPressed);
+  }
+
   double Elevator::getPositionMM() {
     return degreesToMM(motor.position(vex::degrees));
   }
 
   bool Elevator::atTarget() {
-    return (getPositionMM() - heightSetpointMM) < 1;
+    return std::fabs(getPositionMM() - heightSetpointMM) < TOLERANCE_MM;
+  }
+
+  bool Elevator::isHomed() {
+    return homed;
+  }
+
+  bool Elevator::home() {
+    // Already sitting on the switch means there is no edge to catch
+    if (atLowerBound()) {
+      stop();
+      motor.setPosition(0.0, vex::degrees);
+      lowerFault = true;
+      homed = true;
+      return true;
+    }
+
+    homed = false;
+    vex::timer timer;
+    while (!homed && timer.time(vex::msec) < getHomingTimeoutMS()) {
+      setVoltage(vex::reverse, HOMING_VOLTS);
+      wait(10, vex::msec);
+    }
+    stop();
+    heightSetpointMM = 0.0;
+    return homed;
+  }
+
+  double Elevator::getHomingTimeoutMS() {
+    return TRAVEL_MM / HOMING_SPEED_MM_PER_SEC * 1000.0;
+  }
+
+  // Runs on the event thread the moment the switch closes, rather than
+  // whenever the next command happens to check it
+  void Elevator::onUpperPressed() {
+    if (instance == nullptr) {
+      return;
+    }
+    instance->motor.stop(vex::brakeType::hold);
+    instance->upperFault = true;
+  }
+
+  void Elevator::onLowerPressed() {
+    if (instance == nullptr) {
+      return;
+    }
+    instance->motor.stop(vex::brakeType::hold);
+    // The lower switch sits at pickup height, which is zero
+    instance->motor.setPosition(0.0, vex::degrees);
+    instance->lowerFault = true;
+    instance->homed = true;
+  }
+
+  bool Elevator::allowMove(bool movingUp) {
+    // Also catch a switch that was already pressed when the program started
+    if (atUpperBound()) {
+      upperFault = true;
+    }
+    if (atLowerBound()) {
+      lowerFault = true;
+    }
+
+    if (movingUp) {
+      if (upperFault) {
+        return false;
+      }
+      lowerFault = false;
+    } else {
+      if (lowerFault) {
+        return false;
+      }
+      upperFault = false;
+    }
+    return true;
   }
 
   bool Elevator::atUpperBound() {
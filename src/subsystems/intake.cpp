@@ -8,6 +8,7 @@
 
 #include "subsystems/intake.h"
 #include "lib/telemetry.h"
+#include <cmath>
 
 namespace subsystems {
   Intake::Intake(
@@ -48,6 +49,25 @@ namespace subsystems {
     return motor.position(vex::rev);
   }
 
+  bool Intake::zero(double timeoutMS) {
+    vex::timer timer;
+    bool stalled = false;
+    while (!stalled && timer.time(vex::msec) < timeoutMS) {
+      setVoltage(vex::reverse, ZEROING_VOLTS);
+      wait(10, vex::msec);
+
+      stalled = timer.time(vex::msec) > ZEROING_SPIN_UP_MS
+        && std::fabs(motor.velocity(vex::rpm)) < STALLED_RPM;
+    }
+    stop();
+
+    if (stalled) {
+      motor.setPosition(0.0, vex::rev);
+      positionSetpointRotations = 0.0;
+    }
+    return stalled;
+  }
+
   bool Intake::touchingSurface() {
     return limitSwitchSurface.value() == 1;
   }